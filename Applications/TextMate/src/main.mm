@@ -1,4 +1,5 @@
 #import <oak/debug.h>
+#import <oak/trace.h>
 #import <OakSystem/src/application.h>
 #import <DocumentWindow/src/DocumentWindowController.h>
 #import <io/src/path.h>
@@ -21,6 +22,14 @@ static void sig_term_handler (void* unused)
 	[NSUserDefaults.standardUserDefaults synchronize];
 }
 
+static std::string TracePath;
+
+static void write_trace ()
+{
+	if(oak::trace::write_chrome_json(TracePath))
+		fprintf(stderr, "Wrote trace to %s\n", TracePath.c_str());
+}
+
 static void increase_max_open_files (rlim_t required = 2048)
 {
 	struct rlimit limit;
@@ -53,6 +62,13 @@ int main (int argc, char const* argv[])
 
 	increase_max_open_files();
 
+	if(char const* tracePath = getenv("TM_TRACE_PATH")) // Chrome trace JSON is written on exit
+	{
+		TracePath = tracePath;
+		oak::trace::set_enabled(true);
+		atexit(&write_trace);
+	}
+
 	signal(SIGINT,  SIG_IGN);
 	signal(SIGTERM, SIG_IGN);
 	signal(SIGPIPE, SIG_IGN);
@@ -1,9 +1,10 @@
 #include <parse/grammar.h>
 #include <parse/parse.h>
 #include <test/bundle_index.h>
+#include <text/format.h>
+#include <scope/xml_writer.h>
 #include <oak/duration.h>
 #include <oak/oak.h>
-#include <iostream>
 
 static double const AppVersion = 1.0;
 
@@ -16,79 +17,137 @@ void usage (FILE* io)
 {
 	fprintf(io,
 		"%1$s %2$.1f (" __DATE__ ")\n"
-		"Usage: %1$s [-g<selector>td<string>lhv] grammar ...\n"
+		"Usage: %1$s [-g<selector>td<string>lp<format>hv] grammar ...\n"
 		"Options:\n"
 		" -g, --grammar <selector>  Which grammar to use.\n"
 		" -t, --trim                Show only first letter of each scope fragment.\n"
 		" -d, --delimiters <string> Surround scopes using argument. See example.\n"
 		" -l, --verbose             Be verbose (output timings).\n"
 		" -i, --load-index          Load bundle index (standard grammars available).\n"
+		" -p, --profile <format>    Report time spent per grammar rule on stderr.\n"
+		"                           Format is ‘table’ or ‘json’.\n"
 		" -h, --help                Show this information.\n"
 		" -v, --version             Print version information.\n"
 		"\n", getprogname(), AppVersion
 	);
 }
 
-template <typename _InputIter, typename _OutputIter>
-_OutputIter entity_escape (_InputIter first, _InputIter const& last, _OutputIter out)
+static std::string json_escape (std::string const& str)
 {
-	ASSERT(!(last < first));
+	std::string res;
+	for(char ch : str)
+	{
+		switch(ch)
+		{
+			case '"':  res += "\\\""; break;
+			case '\\': res += "\\\\"; break;
+			case '\n': res += "\\n";  break;
+			case '\r': res += "\\r";  break;
+			case '\t': res += "\\t";  break;
+			default:
+			{
+				if((unsigned char)ch < 0x20)
+						res += text::format("\\u%04x", ch);
+				else	res += ch;
+			}
+			break;
+		}
+	}
+	return res;
+}
 
-	static typename std::iterator_traits<_InputIter>::value_type const special[] = { '<', '>', '&' };
-	static std::string const escaped[] = { "&lt;", "&gt;", "&amp;" };
+static std::string rule_name (parse::profile_t::rule_stats_t const& stats)
+{
+	if(stats.scope != NULL_STR)
+		return stats.scope;
+	return stats.match_string != NULL_STR ? stats.match_string : "(untitled)";
+}
 
-	while(first != last)
+static void report_profile (parse::profile_t const& profile, size_t bytes, double seconds, std::string const& format)
+{
+	std::vector<std::pair<size_t, parse::profile_t::rule_stats_t const*>> rules;
+	double searchTime = 0;
+	for(auto const& pair : profile.rules)
 	{
-		_InputIter it = std::find_first_of(first, last, special, special + sizeofA(special));
-		out = std::copy(first, it, out);
-		first = it;
+		rules.emplace_back(pair.first, &pair.second);
+		searchTime += pair.second.total_time();
+	}
+
+	std::sort(rules.begin(), rules.end(), [](auto const& lhs, auto const& rhs){
+		return lhs.second->total_time() > rhs.second->total_time();
+	});
 
-		if(first != last)
+	if(format == "json")
+	{
+		fprintf(stderr, "{\n\t\"bytes\": %zu,\n\t\"seconds\": %.6f,\n\t\"search_seconds\": %.6f,\n\t\"collect_rules\": %zu,\n\t\"rules\": [", bytes, seconds, searchTime, profile.collect_rules);
+		for(size_t i = 0; i < rules.size(); ++i)
 		{
-			size_t idx = std::find(special, special + sizeofA(special), *first) - special;
-			out = std::copy(escaped[idx].begin(), escaped[idx].end(), out);
-			++first;
+			auto const& stats = *rules[i].second;
+			fprintf(stderr, "%s\n\t\t{ \"id\": %zu, \"scope\": \"%s\", \"match\": \"%s\", \"end\": \"%s\", \"seconds\": %.6f, ", i ? "," : "", rules[i].first, stats.scope != NULL_STR ? json_escape(stats.scope).c_str() : "", stats.match_string != NULL_STR ? json_escape(stats.match_string).c_str() : "", stats.end_string != NULL_STR ? json_escape(stats.end_string).c_str() : "", stats.total_time());
+			fprintf(stderr, "\"match_tries\": %zu, \"match_hits\": %zu, \"match_seconds\": %.6f, ", stats.match_tries, stats.match_hits, stats.match_time);
+			fprintf(stderr, "\"end_tries\": %zu, \"end_hits\": %zu, \"end_seconds\": %.6f, ", stats.end_tries, stats.end_hits, stats.end_time);
+			fprintf(stderr, "\"while_tries\": %zu, \"while_hits\": %zu, \"while_seconds\": %.6f }", stats.while_tries, stats.while_hits, stats.while_time);
+		}
+		fprintf(stderr, "\n\t]\n}\n");
+	}
+	else
+	{
+		fprintf(stderr, "parsed %zu bytes in %.3fs, %.3fs spent searching, rules collected %zu times\n\n", bytes, seconds, searchTime, profile.collect_rules);
+		fprintf(stderr, "%10s %6s %10s %10s %10s %10s  %s\n", "ms", "%", "tries", "hits", "end tries", "end hits", "rule");
+		for(auto const& pair : rules)
+		{
+			auto const& stats = *pair.second;
+			fprintf(stderr, "%10.2f %6.1f %10zu %10zu %10zu %10zu  %s\n", 1000 * stats.total_time(), searchTime > 0 ? 100 * stats.total_time() / searchTime : 0, stats.match_tries, stats.match_hits, stats.end_tries + stats.while_tries, stats.end_hits + stats.while_hits, rule_name(stats).c_str());
 		}
 	}
-	return out;
 }
 
-void parse_stdin (std::string const& grammarSelector = "text.plain", bool verbose = false)
+void parse_stdin (std::string const& grammarSelector = "text.plain", bool verbose = false, std::string const& profileFormat = NULL_STR)
 {
 	for(auto const& item : bundles::query(bundles::kFieldGrammarScope, grammarSelector, scope::wildcard, bundles::kItemTypeGrammar))
 	{
 		if(parse::grammar_ptr grammar = parse::parse_grammar(item))
 		{
 			parse::stack_ptr stack = grammar->seed();
-			scope::scope_t lastScope(grammarSelector);
+
+			parse::profile_t profile;
+			if(profileFormat != NULL_STR)
+				parse::set_profile(&profile);
 
 			oak::duration_t timer;
 			size_t bytes = 0;
 
+			scope::xml_writer_t writer([](char const* data, size_t len){ return fwrite(data, 1, len, stdout) == len; }, scope::scope_t(grammarSelector), true);
+
 			static char buf[16384];
 			while(fgets(buf, sizeof(buf), stdin))
 			{
+				size_t const len = strlen(buf);
 				std::map<size_t, scope::scope_t> scopes;
-				stack = parse::parse(buf, buf + strlen(buf), stack, scopes, bytes == 0);
-				bytes += strlen(buf);
+				stack = parse::parse(buf, buf + len, stack, scopes, bytes == 0);
+				bytes += len;
 
 				size_t lastPos = 0;
 				for(auto const& it : scopes)
 				{
-					entity_escape(buf + lastPos, buf + it.first, std::ostream_iterator<char>(std::cout));
-					// std::copy(buf + lastPos, buf + it.first, std::ostream_iterator<char>(std::cout));
-					std::cout << xml_difference(lastScope, it.second, "<", ">");
-					lastScope = it.second;
+					writer.text(buf + lastPos, buf + it.first);
+					writer.set_scope(it.second);
 					lastPos = it.first;
 				}
-				entity_escape(buf + lastPos, buf + strlen(buf), std::ostream_iterator<char>(std::cout));
-				// std::copy(buf + lastPos, buf + strlen(buf), std::ostream_iterator<char>(std::cout));
+				writer.text(buf + lastPos, buf + len);
 			}
-			std::cout << xml_difference(lastScope, grammarSelector, "<", ">") << std::endl;
+			writer.set_scope(grammarSelector);
+			fputc('\n', stdout);
 
 			if(verbose)
 				fprintf(stderr, "parsed %zu bytes in %.1fs (%.0f bytes/s)\n", bytes, timer.duration(), bytes / timer.duration());
 
+			if(profileFormat != NULL_STR)
+			{
+				parse::set_profile(nullptr);
+				report_profile(profile, bytes, timer.duration(), profileFormat);
+			}
+
 			return;
 		}
 	}
@@ -128,16 +187,17 @@ int main (int argc, char* const* argv)
 		{ "delimiters",       required_argument,   0,      'd'   },
 		{ "verbose",          no_argument,         0,      'l'   },
 		{ "load-index",       no_argument,         0,      'i'   },
+		{ "profile",          required_argument,   0,      'p'   },
 		{ "help",             no_argument,         0,      'h'   },
 		{ "version",          no_argument,         0,      'v'   },
 		{ 0,                  0,                   0,      0     }
 	};
 
 	bool verbose = false, trim = false, loadIndex = false;
-	std::string grammar = NULL_STR, delimiters = NULL_STR;
+	std::string grammar = NULL_STR, delimiters = NULL_STR, profileFormat = NULL_STR;
 
 	int ch;
-	while((ch = getopt_long(argc, argv, "g:td:lihv", longopts, nullptr)) != -1)
+	while((ch = getopt_long(argc, argv, "g:td:lip:hv", longopts, nullptr)) != -1)
 	{
 		switch(ch)
 		{
@@ -146,6 +206,7 @@ int main (int argc, char* const* argv)
 			case 'd': delimiters = optarg; break; // TODO
 			case 'l': verbose = true;      break;
 			case 'i': loadIndex = true;    break;
+			case 'p': profileFormat = optarg; break;
 			case 'h': usage(stdout);       return EX_OK;
 			case 'v': version();           return EX_OK;
 			default:  usage(stderr);       return EX_USAGE;
@@ -155,6 +216,12 @@ int main (int argc, char* const* argv)
 	argc -= optind;
 	argv += optind;
 
+	if(profileFormat != NULL_STR && profileFormat != "table" && profileFormat != "json")
+	{
+		fprintf(stderr, "%s: unknown profile format ‘%s’, expected ‘table’ or ‘json’\n", getprogname(), profileFormat.c_str());
+		return EX_USAGE;
+	}
+
 	if(loadIndex)
 	{
 		load_bundle_index(verbose);
@@ -199,6 +266,6 @@ int main (int argc, char* const* argv)
 		}
 	}
 
-	parse_stdin(grammar, verbose);
+	parse_stdin(grammar, verbose, profileFormat);
 	return EX_OK;
 }
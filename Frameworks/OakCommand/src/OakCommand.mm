@@ -5,12 +5,11 @@
 #import <cf/src/cf.h>
 #import <ns/src/ns.h>
 #import <io/src/environment.h>
-#import <io/src/pipe.h>
 #import <text/src/tokenize.h>
 #import <text/src/trim.h>
 #import <text/src/encode.h>
 #import <text/src/parse.h>
-#import <command/src/runner.h> // bundle_command_t, fix_shebang, create_script_path
+#import <command/src/runner.h> // bundle_command_t, fix_shebang, create_script_path, spawn_script
 #import <bundles/src/wrappers.h>
 #import <regexp/src/format_string.h>
 #import <OakAppKit/src/OakToolTip.h>
@@ -39,75 +38,6 @@ static NSString* const kOakFileHandleURLScheme = @"x-txmt-filehandle";
 - (BOOL)presentError:(NSError*)anError;
 @end
 
-static std::tuple<pid_t, int, int> my_fork (char const* cmd, int inputRead, std::map<std::string, std::string> const& environment, char const* workingDir)
-{
-	for(auto const& pair : environment)
-	{
-		if(pair.first.size() + pair.second.size() + 2 < ARG_MAX)
-			continue;
-
-		std::map<std::string, std::string> newEnv;
-		for(auto const& pair : environment)
-		{
-			if(pair.first.size() + pair.second.size() + 2 < ARG_MAX)
-			{
-				newEnv.insert(pair);
-			}
-			else
-			{
-				newEnv.emplace(pair.first, "(truncated)");
-				os_log_error(OS_LOG_DEFAULT, "Variable exceeds ARG_MAX: %{public}s", pair.first.c_str());
-			}
-		}
-		return my_fork(cmd, inputRead, newEnv, workingDir);
-	}
-
-	int outputRead, outputWrite, errorRead, errorWrite;
-	std::tie(outputRead, outputWrite) = io::create_pipe();
-	std::tie(errorRead,  errorWrite)  = io::create_pipe();
-
-	oak::c_array env(environment);
-
-	pid_t pid = vfork();
-	if(pid == 0)
-	{
-		int const signals[] = { SIGINT, SIGTERM, SIGPIPE, SIGUSR1 };
-		for(int sig : signals) signal(sig, SIG_DFL);
-
-		int const oldOutErr[] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
-		int const newOutErr[] = { inputRead, outputWrite, errorWrite };
-
-		for(int fd = getdtablesize(); --fd > STDERR_FILENO; )
-		{
-			int flags = fcntl(fd, F_GETFD);
-			if((flags == -1 && errno == EBADF) || (flags & FD_CLOEXEC) == FD_CLOEXEC)
-				continue;
-
-			if(close(fd) == -1)
-			{
-				perror("close");
-				_exit(EXIT_FAILURE);
-			}
-		}
-
-		for(int fd : oldOutErr) close(fd);
-		for(int fd : newOutErr) dup(fd);
-
-		setpgid(0, getpid());
-		chdir(workingDir);
-
-		char* argv[] = { (char*)cmd, NULL };
-		execve(argv[0], argv, env);
-		perror("execve");
-		_exit(EXIT_FAILURE);
-	}
-
-	int const fds[] = { outputWrite, errorWrite };
-	for(int fd : fds) close(fd);
-
-	return { pid, outputRead, errorRead };
-}
-
 static void exhaust_fd_in_queue (dispatch_group_t group, int fd, CFRunLoopRef runLoop, void(^handler)(char const* bytes, size_t len))
 {
 	dispatch_group_async(group, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
@@ -134,7 +64,7 @@ static pid_t run_command (dispatch_group_t rootGroup, std::string const& cmd, in
 {
 	pid_t pid;
 	int outputFd, errorFd;
-	std::tie(pid, outputFd, errorFd) = my_fork(cmd.c_str(), inputFd, env, cwd.c_str());
+	std::tie(pid, outputFd, errorFd) = command::spawn_script(cmd, inputFd, env, cwd);
 
 	dispatch_group_t group = dispatch_group_create();
 	exhaust_fd_in_queue(group, outputFd, runLoop, stdoutHandler);
@@ -142,7 +72,9 @@ static pid_t run_command (dispatch_group_t rootGroup, std::string const& cmd, in
 
 	__block int status = 0;
 	dispatch_group_async(group, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
-		if(waitpid(pid, &status, 0) != pid)
+		if(pid == -1)
+			status = W_EXITCODE(EXIT_FAILURE, 0);
+		else if(waitpid(pid, &status, 0) != pid)
 			perror("OakCommand: waitpid");
 	});
 
@@ -502,7 +434,7 @@ static pid_t run_command (dispatch_group_t rootGroup, std::string const& cmd, in
 
 - (void)terminate
 {
-	if(_processIdentifier != 0)
+	if(_processIdentifier > 0)
 	{
 		_userDidAbort = YES;
 		oak::kill_process_group_in_background(_processIdentifier);
@@ -138,6 +138,11 @@ NSUInteger const kFileChooserUncommittedChangesSourceIndex = 2;
 	}
 }
 
+- (std::string)rankingString
+{
+	return _directory + "/" + _file;
+}
+
 - (void)updateRankUsingGlob:(path::glob_t const&)glob
 {
 	[self reset];
@@ -224,6 +229,7 @@ static NSDictionary* globs_for_path (std::string const& path)
 {
 	scm::info_ptr                     _scmInfo;
 	NSMutableArray<FileChooserItem*>* _records;
+	oak::ranker_t                     _ranker;
 
 	NSString* _globString;
 	NSString* _filterString;
@@ -324,6 +330,7 @@ static NSDictionary* globs_for_path (std::string const& path)
 	[self stopSearch];
 	_scmInfo.reset();
 	_records = nil;
+	_ranker.clear();
 
 	self.items = @[ ];
 }
@@ -368,38 +375,64 @@ static NSDictionary* globs_for_path (std::string const& path)
 
 	NSUInteger firstDirty = _records.count;
 	for(OakDocument* doc in documents)
-		[_records addObject:[[FileChooserItem alloc] initWithDocument:doc base:path isCurrent:[doc.identifier isEqual:_currentDocument]]];
+	{
+		FileChooserItem* item = [[FileChooserItem alloc] initWithDocument:doc base:path isCurrent:[doc.identifier isEqual:_currentDocument]];
+		[_records addObject:item];
+		_ranker.add([item rankingString]);
+	}
 
 	[self updateRecordsFrom:firstDirty];
 }
 
 - (void)updateRecordsFrom:(NSUInteger)first
 {
-	SEL compareSelector = @selector(compare:);
 	if(OakNotEmptyString(_globString))
 	{
 		path::glob_t const glob(to_s(_globString), false, false);
 		[_records enumerateObjectsAtIndexes:[NSIndexSet indexSetWithIndexesInRange:NSMakeRange(first, _records.count - first)] options:NSEnumerationConcurrent usingBlock:^(FileChooserItem* item, NSUInteger idx, BOOL* stop){
 			[item updateRankUsingGlob:glob];
 		}];
+
+		NSArray* array = [_records filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"isMatched == YES"]];
+		self.items = [array sortedArrayUsingSelector:@selector(compare:)];
 	}
 	else
 	{
-		compareSelector = @selector(rankCompare:);
-
-		std::string const filter = to_s(_filterString);
+		std::string const filter = to_s(_filterString ?: @"");
 
 		std::vector<std::string> bindings;
 		for(NSString* str in [[OakAbbreviations abbreviationsForName:@"OakFileChooserBindings"] stringsForAbbreviation:_filterString])
 			bindings.push_back(to_s(str));
 
-		[_records enumerateObjectsAtIndexes:[NSIndexSet indexSetWithIndexesInRange:NSMakeRange(first, _records.count - first)] options:NSEnumerationConcurrent usingBlock:^(FileChooserItem* item, NSUInteger idx, BOOL* stop){
-			[item updateRankUsingFilter:filter bindings:bindings];
-		}];
-	}
+		if(first == 0)
+		{
+			for(FileChooserItem* item in self.items)
+				[item reset];
+		}
+
+		// Only candidates containing the filter as a subsequence can match and they are narrowed incrementally
+		std::vector<size_t> const& candidates = _ranker.filter(filter);
+		size_t const* begin = std::lower_bound(candidates.data(), candidates.data() + candidates.size(), first);
+		size_t const count  = candidates.data() + candidates.size() - begin;
+		NSArray* records    = _records;
+
+		size_t const stride = 256;
+		dispatch_apply((count + stride - 1) / stride, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0), ^(size_t n){
+			for(size_t i = n * stride; i < std::min((n + 1) * stride, count); ++i)
+				[records[begin[i]] updateRankUsingFilter:filter bindings:bindings];
+		});
 
-	NSArray* array = [_records filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"isMatched == YES"]];
-	self.items = [array sortedArrayUsingSelector:compareSelector];
+		std::vector<FileChooserItem*> matched;
+		for(size_t index : candidates)
+		{
+			if(_records[index].isMatched)
+				matched.push_back(_records[index]);
+		}
+
+		std::sort(matched.begin(), matched.end(), [](FileChooserItem* lhs, FileChooserItem* rhs){ return [lhs rankCompare:rhs] == NSOrderedAscending; });
+
+		self.items = [NSArray arrayWithObjects:matched.data() count:matched.size()];
+	}
 }
 
 // ========
@@ -436,6 +469,7 @@ static NSDictionary* globs_for_path (std::string const& path)
 		case kFileChooserOpenDocumentsSourceIndex:
 		{
 			_records = [NSMutableArray array];
+			_ranker.clear();
 			[self addRecordsForDocuments:[OakDocumentController.sharedInstance openDocuments]];
 		}
 		break;
@@ -459,6 +493,7 @@ static NSDictionary* globs_for_path (std::string const& path)
 	}
 
 	_records = [NSMutableArray array];
+	_ranker.clear();
 	if(_scmInfo)
 	{
 		NSMutableArray<OakDocument*>* scmStatus = [NSMutableArray array];
@@ -478,6 +513,7 @@ static NSDictionary* globs_for_path (std::string const& path)
 
 	self.items = @[ ];
 	_records = [NSMutableArray array];
+	_ranker.clear();
 
 	if(!path)
 		return;
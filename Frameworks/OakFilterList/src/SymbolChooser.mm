@@ -79,8 +79,13 @@ static SymbolChooserItem* CreateItem (OakDocument* document, text::pos_t const&
 
 - (void)setTMDocument:(OakDocument*)aDocument
 {
+	if(_TMDocument)
+		[NSNotificationCenter.defaultCenter removeObserver:self name:OakDocumentSymbolsDidChangeNotification object:_TMDocument];
 	if(_TMDocument = aDocument)
+	{
+		[NSNotificationCenter.defaultCenter addObserver:self selector:@selector(updateItems:) name:OakDocumentSymbolsDidChangeNotification object:_TMDocument];
 		[self updateItems:self];
+	}
 	NSString* title = @"Jump to Symbol";
 	self.window.title = _TMDocument ? [title stringByAppendingFormat:@" — %@", _TMDocument.displayName] : title;
 }
@@ -356,6 +356,7 @@ struct document_view_t : ng::buffer_api_t
 	std::string substr (size_t from = 0, size_t to = SIZE_T_MAX) const { return [_document_editor buffer].substr(from, to != SIZE_T_MAX ? to : size()); }
 	std::string xml_substr (size_t from = 0, size_t to = SIZE_T_MAX) const { return [_document_editor buffer].xml_substr(from, to); }
 	bool visit_data (std::function<void(char const*, size_t, size_t, bool*)> const& f) const { return [_document_editor buffer].visit_data(f); }
+	ng::snapshot_t snapshot (size_t from, size_t to, bool xml = false) const { return [_document_editor buffer].snapshot(from, to, xml); }
 	size_t begin (size_t n) const { return [_document_editor buffer].begin(n); }
 	size_t eol (size_t n) const { return [_document_editor buffer].eol(n); }
 	size_t end (size_t n) const { return [_document_editor buffer].end(n); }
@@ -950,6 +951,9 @@ static std::string shell_quote (std::vector<std::string> paths)
 			buffer_refresh_callback_t (OakTextView* textView) : textView(textView) { }
 			void did_parse (size_t from, size_t to)                                { [textView redisplayFrom:from to:to]; [textView updateSymbol]; }
 			void did_replace (size_t from, size_t to, char const* buf, size_t len) { NSAccessibilityPostNotification(textView, NSAccessibilityValueChangedNotification); }
+			void did_replace_batch (std::vector<ng::replacement_t> const& replacements) { NSAccessibilityPostNotification(textView, NSAccessibilityValueChangedNotification); }
+			void did_update_spelling (size_t from, size_t to)                      { [textView redisplayFrom:from to:to]; }
+			void did_update_symbols ()                                             { [textView updateSymbol]; }
 
 		private:
 			__weak OakTextView* textView;
@@ -3242,8 +3246,12 @@ static void update_menu_key_equivalents (NSMenu* menu, std::multimap<std::string
 				if(newSelection.empty() && (options & find::wrap_around) && alreadySelected.size() == 1)
 				{
 					auto selection = *alreadySelected.begin();
-					auto tmp = ng::find_all(*documentView, findStr, options, { selection });
-					if(tmp.size() == 1 && tmp.begin()->first.sorted() == selection)
+					ng::ranges_t matches;
+					ng::each_match(*documentView, findStr, options, { selection }, false, [&matches](ng::range_t const& range, std::map<std::string, std::string> const*, bool* stop){
+						matches.push_back(range);
+						*stop = matches.size() > 1;
+					});
+					if(matches.size() == 1 && matches.last().sorted() == selection)
 						newSelection.push_back(selection);
 				}
 
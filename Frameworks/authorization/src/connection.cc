@@ -33,21 +33,21 @@ connection_t::connection_t (std::string const& socketPath)
 
 connection_t& connection_t::operator<< (bool value)
 {
-	write(_socket, &value, sizeof(value));
+	::write(_socket, &value, sizeof(value));
 	return *this;
 }
 
 connection_t& connection_t::operator<< (int value)
 {
 	value = to_network(value);
-	write(_socket, &value, sizeof(value));
+	::write(_socket, &value, sizeof(value));
 	return *this;
 }
 
 connection_t& connection_t::operator<< (size_t value)
 {
 	value = to_network(value);
-	write(_socket, &value, sizeof(value));
+	::write(_socket, &value, sizeof(value));
 	return *this;
 }
 
@@ -58,8 +58,25 @@ connection_t& connection_t::operator<< (char const* str)
 
 connection_t& connection_t::operator<< (std::string const& value)
 {
-	*this << value.size();
-	write(_socket, value.data(), value.size());
+	return write(value.data(), value.size());
+}
+
+connection_t& connection_t::write (char const* bytes, size_t len)
+{
+	*this << len;
+	while(len)
+	{
+		ssize_t res = ::write(_socket, bytes, std::min<size_t>(len, 1024*1024));
+		if(res == -1 && errno == EINTR)
+			continue;
+		if(res == -1)
+		{
+			perror("connection_t: write");
+			break;
+		}
+		bytes += res;
+		len   -= res;
+	}
 	return *this;
 }
 
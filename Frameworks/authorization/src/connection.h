@@ -19,6 +19,7 @@ struct connection_t
 	connection_t& operator<< (size_t value);
 	connection_t& operator<< (char const* str);
 	connection_t& operator<< (std::string const& value);
+	connection_t& write (char const* bytes, size_t len); // same wire format as a string
 
 	template <typename A, typename B>
 	connection_t& operator<< (std::pair<A, B> const& value)
@@ -3,14 +3,15 @@
 #include <oak/oak.h>
 #include <text/src/utf8.h>
 #include <text/src/parse.h>
-#include <regexp/src/format_string.h>
+#include <scope/src/xml_writer.h>
 #include <parse/src/grammar.h>
 
 namespace ng
 {
-	buffer_t::buffer_t () : _grammar_callback(*this), _revision(0), _next_revision(1), _spelling_language("")
+	buffer_t::buffer_t () : _grammar_callback(*this), _revision(0), _next_revision(1), _spelling_language(""), _spelling_dictionary(system_spelling_dictionary())
 	{
 		_meta_data.push_back((_symbols = std::make_shared<symbols_t>()).get());
+		_meta_data.push_back((_words = std::make_shared<words_t>()).get());
 		_meta_data.push_back((_marks = std::make_shared<marks_t>()).get());
 		_meta_data.push_back((_pairs = std::make_shared<pairs_t>()).get());
 		_scopes.set(-1, "text");
@@ -156,6 +157,7 @@ namespace ng
 
 		_storage.erase(from, to);
 		_storage.insert(from, buf, len);
+		_storage_snapshot.reset();
 
 		_dirty.replace(from, to, len, false);
 		_dirty.set(from, true);
@@ -181,6 +183,153 @@ namespace ng
 		return from + len;
 	}
 
+	// ================
+	// = Bulk Replace =
+	// ================
+
+	// Same key mapping as calling indexed_map_t::replace() for each replacement, but in a single pass. Keys must be given in ascending order
+	struct key_mapper_t
+	{
+		key_mapper_t (std::vector<replacement_t> const& replacements, bool bindRight) : _edit(replacements.begin()), _end(replacements.end()), _bind_right(bindRight) { }
+
+		bool operator() (ssize_t key, ssize_t& newKey)
+		{
+			while(_edit != _end && (_bind_right ? (ssize_t)_edit->to <= key : (ssize_t)_edit->to < key))
+			{
+				_delta += _edit->str.size() - (_edit->to - _edit->from);
+				++_edit;
+			}
+
+			if(_edit != _end && (_bind_right ? (ssize_t)_edit->from <= key : (ssize_t)_edit->from < key))
+				return false;
+			newKey = key + _delta;
+			return true;
+		}
+
+	private:
+		std::vector<replacement_t>::const_iterator _edit, _end;
+		bool _bind_right;
+		ssize_t _delta = 0;
+	};
+
+	template <typename _ValT>
+	static void remap (indexed_map_t<_ValT>& map, std::vector<replacement_t> const& replacements, bool bindRight)
+	{
+		indexed_map_t<_ValT> res;
+		key_mapper_t mapper(replacements, bindRight);
+		for(auto const& pair : map)
+		{
+			ssize_t key;
+			if(mapper(pair.first, key))
+				res.set(key, pair.second);
+		}
+		map.swap(res);
+	}
+
+	static void remap (scope_runs_t& runs, std::vector<replacement_t> const& replacements, bool bindRight)
+	{
+		runs.remap(key_mapper_t(replacements, bindRight));
+	}
+
+	void buffer_t::replace (std::vector<replacement_t> const& replacements)
+	{
+		std::vector<replacement_t> effective;
+		for(auto const& r : replacements)
+		{
+			ASSERT_LE(r.from, r.to); ASSERT_LE(r.to, size());
+			ASSERT(effective.empty() || effective.back().to <= r.from);
+			if(r.from != r.to || !r.str.empty())
+				effective.push_back(r);
+		}
+
+		if(effective.size() == 1)
+			replace(effective.front().from, effective.front().to, effective.front().str);
+		else if(!effective.empty())
+			bulk_replace(effective);
+	}
+
+	void buffer_t::bulk_replace (std::vector<replacement_t> const& replacements)
+	{
+		_callbacks(&callback_t::will_replace_batch, std::cref(replacements));
+
+		size_t newSize = size();
+		for(auto const& r : replacements)
+			newSize += r.str.size() - (r.to - r.from);
+
+		// Build the new storage in one pass, copying unchanged bytes chunk by chunk into a single preallocated chunk
+		detail::storage_t storage;
+		storage.reserve(newSize);
+
+		auto chunk = _storage.begin();
+		size_t chunkOffset = 0;
+		auto copyRange = [&](size_t first, size_t last){
+			while(first < last)
+			{
+				while(chunkOffset + (*chunk).size() <= first)
+				{
+					chunkOffset += (*chunk).size();
+					++chunk;
+				}
+
+				size_t const i = first - chunkOffset;
+				size_t const j = std::min(last - chunkOffset, (*chunk).size());
+				storage.insert(storage.size(), (*chunk).data() + i, j - i);
+				first = chunkOffset + j;
+			}
+		};
+
+		size_t pos = 0;
+		for(auto const& r : replacements)
+		{
+			copyRange(pos, r.from);
+			storage.insert(storage.size(), r.str.data(), r.str.size());
+			pos = r.to;
+		}
+		copyRange(pos, size());
+		_storage.swap(storage);
+		_storage_snapshot.reset();
+
+		// Remap meta data in one sweep per index
+		std::vector<std::pair<size_t, scope::scope_t>> preserveScopes;
+		ssize_t delta = 0;
+		for(auto const& r : replacements)
+		{
+			auto scopeIter = _scopes.upper_bound(r.to);
+			if(scopeIter != _scopes.begin() && r.from < (--scopeIter)->first && scopeIter->first <= r.to)
+				preserveScopes.emplace_back(r.from + delta + r.str.size(), scopeIter->second);
+			delta += r.str.size() - (r.to - r.from);
+		}
+
+		remap(_hardlines,     replacements, true);
+		remap(_scopes,        replacements, true);
+		remap(_parser_states, replacements, false);
+		remap(_dirty,         replacements, false);
+
+		delta = 0;
+		for(auto const& r : replacements)
+		{
+			size_t const from = r.from + delta;
+			for(size_t i = 0; i < r.str.size(); ++i)
+			{
+				if(r.str[i] == '\n')
+					_hardlines.set(from + i, true);
+			}
+			_dirty.set(from, true);
+			delta += r.str.size() - (r.to - r.from);
+		}
+
+		for(auto const& pair : preserveScopes)
+			_scopes.set(pair.first, pair.second);
+
+		for(auto const& hook : _meta_data)
+		{
+			riterate(r, replacements)
+				hook->replace(this, r->from, r->to, r->str.size());
+		}
+
+		_callbacks(&callback_t::did_replace_batch, std::cref(replacements));
+	}
+
 	bool buffer_t::set_grammar (bundles::item_ptr const& grammarItem)
 	{
 		if(_grammar)
@@ -301,6 +450,9 @@ namespace ng
 
 	std::map<size_t, std::string> buffer_t::symbols () const    { return _symbols->symbols(this);      }
 	std::string buffer_t::symbol_at (size_t i) const            { return _symbols->symbol_at(this, i); }
+	void buffer_t::wait_for_symbols ()                          { _symbols->wait(this); }
+
+	std::map<std::string, size_t> buffer_t::words (std::string const& prefix, size_t caret) const { return _words->words(this, prefix, caret); }
 
 	// ==================
 	// = Spell Checking =
@@ -309,9 +461,10 @@ namespace ng
 	bool buffer_t::live_spelling () const                                          { return _spelling ? true : false; }
 	std::string const& buffer_t::spelling_language () const                        { return _spelling_language; }
 	std::map<size_t, bool> buffer_t::misspellings (size_t from, size_t to) const   { return _spelling ? _spelling->misspellings(this, from, to) : std::map<size_t, bool>(); }
-	std::pair<size_t, size_t> buffer_t::next_misspelling (size_t from) const       { return _spelling ? _spelling->next_misspelling(from) : std::pair<size_t, size_t>(0, 0); }
+	std::pair<size_t, size_t> buffer_t::next_misspelling (size_t from) const       { return _spelling ? _spelling->next_misspelling(this, from) : std::pair<size_t, size_t>(0, 0); }
 	ns::spelling_tag_t buffer_t::spelling_tag () const                             { return _spelling_tag; }
 	void buffer_t::recheck_spelling (size_t from, size_t to)                       { if(_spelling) _spelling->recheck(this, from, to); }
+	void buffer_t::wait_for_spelling ()                                            { if(_spelling) _spelling->wait(this); }
 
 	void buffer_t::set_live_spelling (bool flag)
 	{
@@ -333,6 +486,13 @@ namespace ng
 		}
 	}
 
+	void buffer_t::set_spelling_dictionary (spelling_dictionary_ptr dictionary)
+	{
+		_spelling_dictionary = dictionary ? dictionary : system_spelling_dictionary();
+		if(_spelling)
+			_spelling->recheck(this, 0, size());
+	}
+
 	// =========
 	// = Marks =
 	// =========
@@ -375,24 +535,92 @@ namespace ng
 
 	std::string buffer_t::xml_substr (size_t from, size_t to) const
 	{
-		to = to != SIZE_T_MAX ? to : size();
-		std::string res = "";
+		return snapshot(from, to != SIZE_T_MAX ? to : size(), true).str();
+	}
+
+	// ============
+	// = Snapshot =
+	// ============
+
+	snapshot_t buffer_t::snapshot (size_t from, size_t to, bool xml) const
+	{
+		ASSERT_LE(from, to); ASSERT_LE(to, size());
+		if(!_storage_snapshot)
+			_storage_snapshot = std::make_shared<detail::storage_t const>(_storage);
+		if(!xml)
+			return snapshot_t(_storage_snapshot, from, to);
 
 		auto first = _scopes.upper_bound(from);
 		auto last  = _scopes.lower_bound(to);
 		if(first != _scopes.begin())
 			--first;
 
-		scope::scope_t lastScope;
-		for(auto it = first; it != last; )
+		std::vector<std::pair<ssize_t, scope::scope_t>> scopes;
+		for(auto it = first; it != last; ++it)
+			scopes.push_back(*it);
+		return snapshot_t(_storage_snapshot, from, to, scopes, true);
+	}
+
+	namespace
+	{
+		// Visits ascending, non-overlapping ranges of the storage without starting over from the first chunk
+		struct storage_cursor_t
 		{
-			res.append(xml_difference(lastScope, it->second, "<", ">"));
-			size_t pos = std::max<ssize_t>(from, it->first);
-			lastScope = it->second;
+			storage_cursor_t (detail::storage_t const& storage) : _chunk(storage.begin()) { }
+
+			template <typename F>
+			bool visit (size_t from, size_t to, F const& f)
+			{
+				while(from < to)
+				{
+					while(_offset + (*_chunk).size() <= from)
+					{
+						_offset += (*_chunk).size();
+						++_chunk;
+					}
+
+					size_t const i = from - _offset;
+					size_t const j = std::min(to - _offset, (*_chunk).size());
+					if(!f((*_chunk).data() + i, j - i))
+						return false;
+					from = _offset + j;
+				}
+				return true;
+			}
+
+		private:
+			detail::storage_t::iterator _chunk;
+			size_t _offset = 0;
+		};
+	}
+
+	bool snapshot_t::write (sink_t const& sink) const
+	{
+		storage_cursor_t cursor(*_storage);
+		if(!_xml)
+			return cursor.visit(_from, _to, sink);
+
+		scope::xml_writer_t writer(sink);
+		auto text = [&writer](char const* data, size_t len){ return writer.text(data, data + len); };
+
+		for(auto it = _scopes.begin(); it != _scopes.end(); )
+		{
+			size_t const from = std::max<ssize_t>(_from, it->first);
+			if(!writer.set_scope(it->second))
+				return false;
 			++it;
-			res.append(format_string::replace(substr(pos, it == last ? to : it->first), "(<)|&", "&${1:?lt:amp};"));
+			if(!cursor.visit(from, it == _scopes.end() ? _to : it->first, text))
+				return false;
 		}
-		return res + xml_difference(lastScope, scope::scope_t(), "<", ">");
+		return writer.set_scope(scope::scope_t());
+	}
+
+	std::string snapshot_t::str () const
+	{
+		std::string res;
+		res.reserve(_xml ? (_to - _from) + 32 * _scopes.size() : _to - _from);
+		write([&res](char const* data, size_t len){ res.append(data, len); return true; });
+		return res;
 	}
 
 } /* ng */
@@ -2,6 +2,7 @@
 #define COMPOSITE_H_BOKD8YWS
 
 #include "indexed_map.h"
+#include "scope_runs.h"
 #include "storage.h"
 #include <oak/callbacks.h>
 #include <text/src/types.h>
@@ -40,10 +41,21 @@ namespace ng
 		using meta_data_t::did_parse;
 
 		bool is_paired (size_t index) const;
+		void add (size_t index, size_t rank);
+		void remove_ranks (std::set<size_t> const& ranks);
 
 		size_t _rank;
 		typedef indexed_map_t<size_t> tree_t;
 		tree_t _pairs;
+		std::map<size_t, tree_t::iterator> _elements; // rank → element in _pairs, use _pairs.refresh() to get its current index
+	};
+
+	struct replacement_t
+	{
+		replacement_t (size_t from, size_t to, std::string const& str) : from(from), to(to), str(str) { }
+
+		size_t from, to;
+		std::string str;
 	};
 
 	struct callback_t
@@ -52,10 +64,57 @@ namespace ng
 		virtual void did_parse (size_t from, size_t to)                                 { }
 		virtual void will_replace (size_t from, size_t to, char const* buf, size_t len) { }
 		virtual void did_replace (size_t from, size_t to, char const* buf, size_t len)  { }
+		virtual void did_update_spelling (size_t from, size_t to)                       { }
+		virtual void did_update_symbols ()                                              { }
+
+		// Sent once for a bulk replace with sorted, non-overlapping ranges in pre-edit coordinates.
+		// The default for will_replace_batch() replays each replacement last-to-first, while the buffer is unchanged, so positions before it remain valid.
+		// The default for did_replace_batch() replays each replacement first-to-last, shifted by the replacements before it, so the positions match the edited buffer. Text after the replacement may already include later replacements.
+		virtual void will_replace_batch (std::vector<replacement_t> const& replacements) { riterate(it, replacements) will_replace(it->from, it->to, it->str.data(), it->str.size()); }
+		virtual void did_replace_batch (std::vector<replacement_t> const& replacements)
+		{
+			ssize_t delta = 0;
+			for(auto const& r : replacements)
+			{
+				did_replace(r.from + delta, r.to + delta, r.str.data(), r.str.size());
+				delta += r.str.size() - (r.to - r.from);
+			}
+		}
 	};
 
+	// Read-only copy of [from, to) which can be written from another thread while the buffer is being edited. The text shares memory with the buffer’s storage and the chunk index is shared by all snapshots taken between two edits, so only the scope boundaries (for XML) are copied.
+	struct snapshot_t
+	{
+		typedef std::function<bool(char const*, size_t)> sink_t;
+
+		snapshot_t (std::shared_ptr<detail::storage_t const> const& storage, size_t from, size_t to, std::vector<std::pair<ssize_t, scope::scope_t>> const& scopes = { }, bool xml = false) : _storage(storage), _from(from), _to(to), _scopes(scopes), _xml(xml) { }
+
+		// Calls ‘sink’ with consecutive pieces of the content, stops and returns false if ‘sink’ does
+		bool write (sink_t const& sink) const;
+		std::string str () const;
+
+	private:
+		std::shared_ptr<detail::storage_t const> _storage;
+		size_t _from = 0, _to = 0;
+		std::vector<std::pair<ssize_t, scope::scope_t>> _scopes;
+		bool _xml = false;
+	};
+
+	// Answers which words are misspelled. Called on a background queue with the distinct words of a batch, the result has an entry per word.
+	struct spelling_dictionary_t
+	{
+		virtual ~spelling_dictionary_t () { }
+		virtual std::vector<bool> misspelled (std::vector<std::string> const& words, std::string const& language, ns::spelling_tag_t const& tag) const = 0;
+	};
+
+	typedef std::shared_ptr<spelling_dictionary_t const> spelling_dictionary_ptr;
+
+	spelling_dictionary_ptr system_spelling_dictionary ();
+	spelling_dictionary_ptr word_list_spelling_dictionary (std::vector<std::string> const& words); // Words not in the list are misspelled
+
 	struct spelling_t;
 	struct symbols_t;
+	struct words_t;
 	struct marks_t;
 
 	struct buffer_api_t
@@ -66,6 +125,7 @@ namespace ng
 		virtual std::string substr (size_t from, size_t to) const = 0;
 		virtual std::string xml_substr (size_t from = 0, size_t to = SIZE_T_MAX) const = 0;
 		virtual bool visit_data (std::function<void(char const*, size_t, size_t, bool*)> const& f) const = 0;
+		virtual snapshot_t snapshot (size_t from, size_t to, bool xml = false) const = 0;
 		virtual size_t begin (size_t n) const = 0;
 		virtual size_t eol (size_t n) const = 0;
 		virtual size_t end (size_t n) const = 0;
@@ -96,12 +156,14 @@ namespace ng
 		std::string substr (size_t from, size_t to) const;
 		std::string xml_substr (size_t from = 0, size_t to = SIZE_T_MAX) const;
 		bool visit_data (std::function<void(char const*, size_t, size_t, bool*)> const& f) const;
+		snapshot_t snapshot (size_t from, size_t to, bool xml = false) const;
 
 		detail::storage_t const& storage () const { return _storage; }
 
 		bool operator== (buffer_t const& rhs) const;
 
 		size_t replace (size_t from, size_t to, char const* buf, size_t len);
+		void replace (std::vector<replacement_t> const& replacements);
 
 		size_t replace (size_t from, size_t to, std::string const& str) { return replace(from, to, str.data(), str.size()); }
 		size_t insert (size_t i, char const* buf, size_t len)           { return replace(i, i, buf, len); }
@@ -129,6 +191,10 @@ namespace ng
 
 		std::map<size_t, std::string> symbols () const;
 		std::string symbol_at (size_t i) const;
+		void wait_for_symbols ();
+
+		// Words starting with ‘prefix’ mapped to their occurrence closest to ‘caret’
+		std::map<std::string, size_t> words (std::string const& prefix, size_t caret) const;
 
 		void set_live_spelling (bool flag);
 		bool live_spelling () const;
@@ -138,6 +204,9 @@ namespace ng
 		std::pair<size_t, size_t> next_misspelling (size_t from) const;
 		ns::spelling_tag_t spelling_tag () const;
 		void recheck_spelling (size_t from, size_t to);
+		void set_spelling_dictionary (spelling_dictionary_ptr dictionary);
+		spelling_dictionary_ptr spelling_dictionary () const { return _spelling_dictionary; }
+		void wait_for_spelling ();
 
 		pairs_t& pairs ()              { return *_pairs.get(); }
 		pairs_t const& pairs () const  { return *_pairs.get(); }
@@ -166,6 +235,7 @@ namespace ng
 	private:
 		friend struct undo_manager_t;
 		void set_revision (size_t newRevision) { ASSERT_LT(newRevision, _next_revision); _revision = newRevision; initiate_repair(20); }
+		size_t allocate_revision ()            { return _next_revision++; }
 		char at (size_t i) const;
 
 		void did_parse (size_t first, size_t last)
@@ -201,6 +271,7 @@ namespace ng
 		void remove_meta_data (meta_data_t* hook)   { if(hook) _meta_data.erase(std::find(_meta_data.begin(), _meta_data.end(), hook)); }
 
 		size_t actual_replace (size_t from, size_t to, char const* buf, size_t len);
+		void bulk_replace (std::vector<replacement_t> const& replacements);
 
 		uint32_t code_point (size_t& i, size_t& len) const;
 		friend std::string to_s (buffer_t const& buf, size_t first, size_t last);
@@ -223,20 +294,24 @@ namespace ng
 		size_t _revision, _next_revision;
 		std::string _spelling_language;
 		ns::spelling_tag_t _spelling_tag;
+		spelling_dictionary_ptr _spelling_dictionary;
 
 		detail::storage_t                _storage;
+		mutable std::shared_ptr<detail::storage_t const> _storage_snapshot; // reset when _storage changes
 		indexed_map_t<bool>              _hardlines;
 		indexed_map_t<bool>              _dirty;
-		indexed_map_t<scope::scope_t>    _scopes;
+		scope_runs_t                     _scopes;
 		indexed_map_t<parse::stack_ptr>  _parser_states;
 
 		std::shared_ptr<spelling_t> _spelling;
 		std::shared_ptr<symbols_t>  _symbols;
+		std::shared_ptr<words_t>    _words;
 		std::shared_ptr<marks_t>    _marks;
 		std::shared_ptr<pairs_t>    _pairs;
 
 		friend struct spelling_t; // _scopes
 		friend struct symbols_t;  // _scopes
+		friend struct words_t;    // _scopes
 	};
 
 	std::string to_s (buffer_t const& buf, size_t first = 0, size_t last = SIZE_T_MAX);
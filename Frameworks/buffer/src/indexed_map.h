@@ -89,6 +89,7 @@ public:
 	iterator lower_bound (ssize_t key) const { return iterator(_tree, _tree.lower_bound(key, &comp_abs)); }
 	iterator upper_bound (ssize_t key) const { return iterator(_tree, _tree.upper_bound(key, &comp_abs)); }
 	iterator nth (size_t n) const            { return iterator(_tree, _tree.find(n, &comp_nth));          }
+	iterator refresh (iterator it) const     { return iterator(_tree, _tree.refresh(it.base()));          }
 
 	void set (ssize_t pos, _ValT const& value)
 	{
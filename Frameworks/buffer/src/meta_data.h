@@ -5,38 +5,97 @@
 
 namespace ng
 {
+	// Misspellings are found on a background queue: Parsing and rechecking only record dirty ranges, these are checked in batches of bounded size with one batch in flight, and callbacks get did_update_spelling() when a batch is merged.
 	struct spelling_t : meta_data_t
 	{
-		bool disabled () const        { return _disabled; }
-		void set_disabled (bool flag) { _disabled = flag; }
+		spelling_t ();
+		~spelling_t ();
 
-		void check_spelling (buffer_t const* buffer);
 		std::map<size_t, bool> misspellings (buffer_t const* buffer, size_t from, size_t to) const;
 
 		bool misspelled_at (size_t i) const;
-		std::pair<size_t, size_t> next_misspelling (size_t from) const;
+		std::pair<size_t, size_t> next_misspelling (buffer_t const* buffer, size_t from) const;
 		void recheck (buffer_t const* buffer, size_t from, size_t to);
+		void wait (buffer_t const* buffer) const;
 
 	private:
 		void replace (buffer_t* buffer, size_t from, size_t to, size_t len);
 		void did_parse (buffer_t const* buffer, size_t from, size_t to);
 
+		struct batch_t;
+		typedef std::map<std::string, bool, std::less<>> known_words_t;
+
+		void schedule (buffer_t const* buffer) const;
+		void flush (buffer_t const* buffer) const;
+		void merge (buffer_t const* buffer) const;
+
 		typedef indexed_map_t<bool> tree_t;
-		tree_t _misspellings;    // true = misspelled, false = proper
-		bool _disabled = false;
+		mutable tree_t _misspellings;                            // true = misspelled, false = proper
+		mutable std::vector<std::pair<size_t, size_t>> _dirty;  // Ranges not yet sent to the spelling queue, kept current by replace()
+		mutable std::shared_ptr<batch_t> _batch;
+		std::shared_ptr<known_words_t> _known_words;            // Word → misspelled, only used on the spelling queue
+		std::shared_ptr<bool> _reference;                       // Blocks posted to the run loop only run while this is alive
+		mutable bool _scheduled = false;
 	};
 
 	struct symbols_t : meta_data_t
 	{
+		symbols_t ();
+		~symbols_t ();
+
 		std::map<size_t, std::string> symbols (buffer_t const* buffer) const;
 		std::string symbol_at (buffer_t const* buffer, size_t i) const;
+		void wait (buffer_t const* buffer) const;
 
 	private:
 		void replace (buffer_t* buffer, size_t from, size_t to, size_t len);
 		void did_parse (buffer_t const* buffer, size_t from, size_t to);
 
+		// Symbols are expanded on a background queue and merged into _symbols in the order they were requested. Queries return what is merged, callbacks get did_update_symbols() when more is.
+		struct batch_t;
+		bool merge (bool wait) const;
+
 		typedef indexed_map_t<std::string> tree_t;
-		tree_t _symbols;
+		mutable tree_t _symbols;
+		mutable std::vector<std::shared_ptr<batch_t>> _pending;
+		std::shared_ptr<bool> _reference; // Blocks posted to the run loop only run while this is alive
+	};
+
+	// Index of the words in the buffer, used for completion. It is built on first use and updated lazily: Edits and parsing only drop the affected lines, which are re-indexed on the next query.
+	struct words_t : meta_data_t
+	{
+		words_t ();
+		~words_t ();
+
+		std::map<std::string, size_t> words (buffer_t const* buffer, std::string const& prefix, size_t caret) const;
+
+	private:
+		void replace (buffer_t* buffer, size_t from, size_t to, size_t len);
+		void did_parse (buffer_t const* buffer, size_t from, size_t to);
+
+		struct line_t;
+		typedef std::shared_ptr<line_t const> line_ptr;
+
+		struct word_t
+		{
+			uint32_t id;
+			size_t count;
+		};
+
+		typedef std::map<std::string, word_t, std::less<>> vocabulary_t;
+
+		void invalidate (size_t from, size_t to, size_t len);
+		void repair (buffer_t const* buffer) const;
+		void index (buffer_t const* buffer, size_t from, size_t to) const;
+		void forget (line_t const& line) const;
+
+		mutable indexed_map_t<line_ptr> _lines;  // start of line → words on that line
+		mutable indexed_map_t<bool> _dirty;      // start of text not covered by _lines
+		mutable vocabulary_t _vocabulary;
+		mutable std::vector<vocabulary_t::iterator> _ids;
+		mutable std::vector<uint32_t> _free_ids;
+		mutable size_t _generation = 0;
+		mutable bool _active = false;
 	};
 
 	struct marks_t : meta_data_t
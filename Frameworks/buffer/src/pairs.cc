@@ -13,39 +13,32 @@ namespace ng
 		{
 			std::set<size_t> ranksToRemove;
 			foreach(it, _pairs.lower_bound(from), _pairs.lower_bound(to))
-			{
-				size_t rank = it->second;
-				ranksToRemove.insert(rank & ~1);
-				ranksToRemove.insert(rank |  1);
-			}
-
-			if(!ranksToRemove.empty())
-			{
-				std::set<ssize_t> indicesToRemove;
-				for(auto const& it : _pairs)
-				{
-					if(ranksToRemove.find(it.second) != ranksToRemove.end())
-						indicesToRemove.insert(it.first);
-				}
-
-				for(auto const& index : indicesToRemove)
-					_pairs.remove(index);
-			}
+				ranksToRemove.insert(it->second);
+			remove_ranks(ranksToRemove);
 		}
 		_pairs.replace(from, to, len);
 	}
 
 	void pairs_t::add_pair (size_t firstIndex, size_t lastIndex)
 	{
-		_pairs.set(firstIndex, _rank++);
-		_pairs.set(lastIndex,  _rank++);
+		std::set<size_t> ranksToRemove;
+		for(size_t index : { firstIndex, lastIndex })
+		{
+			auto it = _pairs.find(index);
+			if(it != _pairs.end())
+				ranksToRemove.insert(it->second);
+		}
+		remove_ranks(ranksToRemove);
+
+		add(firstIndex, _rank++);
+		add(lastIndex,  _rank++);
 	}
 
 	void pairs_t::remove (size_t index)
 	{
-		size_t other = counterpart(index);
-		_pairs.remove(index);
-		_pairs.remove(other);
+		auto it = _pairs.find(index);
+		if(it != _pairs.end())
+			remove_ranks({ it->second });
 	}
 
 	bool pairs_t::is_paired (size_t index) const
@@ -67,15 +60,41 @@ namespace ng
 
 	size_t pairs_t::counterpart (size_t index) const
 	{
-		ASSERT(_pairs.find(index) != _pairs.end());
-		size_t rank = _pairs.find(index)->second;
-		for(auto const& it : _pairs)
+		tree_t::iterator it = _pairs.find(index);
+		ASSERT(it != _pairs.end());
+		if(it == _pairs.end())
+			return index;
+
+		auto other = _elements.find(it->second ^ 1);
+		ASSERT(other != _elements.end());
+		return other != _elements.end() ? _pairs.refresh(other->second)->first : index;
+	}
+
+	void pairs_t::add (size_t index, size_t rank)
+	{
+		_pairs.set(index, rank);
+		_elements.emplace(rank, _pairs.find(index));
+	}
+
+	// Removes the elements with the given ranks as well as their counterparts
+	void pairs_t::remove_ranks (std::set<size_t> const& ranks)
+	{
+		std::set<ssize_t> indicesToRemove;
+		for(size_t rank : ranks)
 		{
-			if((it.second & ~1) == (rank & ~1) && it.second != rank)
-				return it.first;
+			for(size_t r : { rank & ~1, rank | 1 })
+			{
+				auto it = _elements.find(r);
+				if(it != _elements.end())
+				{
+					indicesToRemove.insert(_pairs.refresh(it->second)->first);
+					_elements.erase(it);
+				}
+			}
 		}
-		ASSERT(false);
-		return index;
+
+		for(auto const& index : indicesToRemove)
+			_pairs.remove(index);
 	}
 
 } /* ng */
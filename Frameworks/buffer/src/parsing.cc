@@ -1,5 +1,6 @@
 #include "buffer.h"
 #include "meta_data.h"
+#include <oak/trace.h>
 
 namespace ng
 {
@@ -28,6 +29,8 @@ namespace ng
 
 	void buffer_t::initiate_repair (size_t limit_redraw, size_t batch_start)
 	{
+		oak::trace::span_t span("buffer", "initiate_repair");
+
 		if(!_async_parsing || _parser_running)
 			return;
 
@@ -82,13 +85,10 @@ namespace ng
 
 	void buffer_t::update_scopes (size_t limit_redraw, size_t batch_start, std::pair<size_t, size_t> const& range, std::map<size_t, scope::scope_t> const& newScopes, parse::stack_ptr parserState)
 	{
+		oak::trace::span_t span("buffer", "update_scopes");
+
 		bool atEOF = convert(range.first).line+1 == lines();
-		_scopes.remove(_scopes.lower_bound(range.first), atEOF ? _scopes.end() : _scopes.lower_bound(range.second));
-		for(auto const& pair : newScopes)
-		{
-			if(range.first + pair.first < range.second || atEOF)
-				_scopes.set(range.first + pair.first, pair.second);
-		}
+		_scopes.assign(range.first, atEOF ? SSIZE_MAX : range.second, newScopes);
 
 		_dirty.remove(_dirty.lower_bound(range.first), atEOF ? _dirty.end() : _dirty.lower_bound(range.second));
 		if((_parser_states.find(range.second) == _parser_states.end() || !parse::equal(parserState, (_parser_states.find(range.second)->second))))
@@ -121,12 +121,6 @@ namespace ng
 		_parser_reference.reset();
 		_parser_running = false;
 
-		// Using the NSSpellChecker API while main thread is blocked can result in this exception:
-		// Dispatch Thread Soft Limit Reached: 64 (too many dispatch threads blocked in synchronous operations)
-		// Therefor we disable spell checking during refresh. First noticed with macOS 10.12
-		if(_spelling)
-			_spelling->set_disabled(true);
-
 		std::lock_guard<std::mutex> lock(grammar()->mutex());
 		while(!_dirty.empty() && !_parser_states.empty())
 		{
@@ -145,9 +139,6 @@ namespace ng
 			auto newState = parse::parse(line.data(), line.data() + line.size(), state->second, newScopes, from == 0);
 			update_scopes(0, from, std::make_pair(from, to), newScopes, newState);
 		}
-
-		if(_spelling)
-			_spelling->set_disabled(false);
 	}
 
 } /* ng */
@@ -0,0 +1,293 @@
+#include "scope_runs.h"
+
+namespace ng
+{
+	// ============
+	// = Iterator =
+	// ============
+
+	scope_runs_t::iterator& scope_runs_t::iterator::operator++ ()
+	{
+		if(++_index == _base->second->entries.size())
+		{
+			++_base;
+			_index = 0;
+		}
+		update_value();
+		return *this;
+	}
+
+	scope_runs_t::iterator& scope_runs_t::iterator::operator-- ()
+	{
+		if(_index == 0)
+		{
+			--_base;
+			_index = _base->second->entries.size();
+		}
+		--_index;
+		update_value();
+		return *this;
+	}
+
+	void scope_runs_t::iterator::update_value ()
+	{
+		if(_base != _runs->_runs.end())
+		{
+			run_t::entry_t const& entry = _base->second->entries[_index];
+			_value.first  = _base->first + entry.offset;
+			_value.second = _runs->_scopes[entry.scope];
+		}
+	}
+
+	// ================
+	// = scope_runs_t =
+	// ================
+
+	void scope_runs_t::clear ()
+	{
+		_runs.clear();
+		_scopes.clear();
+		_scope_ids.clear();
+		_pool.clear();
+	}
+
+	scope_runs_t::iterator scope_runs_t::begin () const               { return iterator(*this, _runs.begin()); }
+	scope_runs_t::iterator scope_runs_t::end () const                 { return iterator(*this, _runs.end()); }
+	scope_runs_t::iterator scope_runs_t::lower_bound (ssize_t key) const { return bound(key, false); }
+	scope_runs_t::iterator scope_runs_t::upper_bound (ssize_t key) const { return bound(key, true); }
+
+	scope_runs_t::iterator scope_runs_t::find (ssize_t key) const
+	{
+		iterator res = lower_bound(key);
+		return res != end() && res->first == key ? res : end();
+	}
+
+	scope_runs_t::iterator scope_runs_t::bound (ssize_t key, bool upper) const
+	{
+		auto run = _runs.upper_bound(key);
+		if(run != _runs.begin())
+		{
+			auto prev = run;
+			--prev;
+
+			size_t const offset = key - prev->first;
+			auto const& entries = prev->second->entries;
+			auto it = upper
+				? std::upper_bound(entries.begin(), entries.end(), offset, [](size_t lhs, run_t::entry_t const& rhs){ return lhs < rhs.offset; })
+				: std::lower_bound(entries.begin(), entries.end(), offset, [](run_t::entry_t const& lhs, size_t rhs){ return lhs.offset < rhs; });
+			if(it != entries.end())
+				return iterator(*this, prev, it - entries.begin());
+		}
+		return iterator(*this, run);
+	}
+
+	void scope_runs_t::set (ssize_t pos, scope::scope_t const& scope)
+	{
+		scope_id_t const id = scope_id(scope);
+
+		auto run = run_containing(pos);
+		if(run == _runs.end())
+			return insert({ { pos, id } });
+
+		entries_t tmp;
+		entries(run, tmp);
+		auto it = std::lower_bound(tmp.begin(), tmp.end(), pos, [](std::pair<ssize_t, scope_id_t> const& lhs, ssize_t rhs){ return lhs.first < rhs; });
+		if(it != tmp.end() && it->first == pos)
+		{
+			if(it->second == id)
+				return;
+			it->second = id;
+		}
+		else
+		{
+			tmp.emplace(it, pos, id);
+		}
+		insert(tmp); // ‘run’ starts at tmp.front() so this replaces it
+	}
+
+	void scope_runs_t::assign (ssize_t from, ssize_t to, std::map<size_t, scope::scope_t> const& scopes)
+	{
+		for(auto const& group : extract(from, to, false))
+		{
+			auto split = std::lower_bound(group.begin(), group.end(), from, [](std::pair<ssize_t, scope_id_t> const& lhs, ssize_t rhs){ return lhs.first < rhs; });
+			if(split != group.begin())
+				insert(entries_t(group.begin(), split));
+
+			auto tail = std::lower_bound(split, group.end(), to, [](std::pair<ssize_t, scope_id_t> const& lhs, ssize_t rhs){ return lhs.first < rhs; });
+			if(tail != group.end())
+				insert(entries_t(tail, group.end()));
+		}
+
+		entries_t fresh;
+		for(auto const& pair : scopes)
+		{
+			if(from + (ssize_t)pair.first < to)
+				fresh.emplace_back(from + pair.first, scope_id(pair.second));
+		}
+
+		if(!fresh.empty())
+			insert(fresh);
+	}
+
+	void scope_runs_t::replace (ssize_t from, ssize_t to, size_t newLength)
+	{
+		std::vector<entries_t> groups = extract(from, to, true);
+		_runs.replace(from, to, newLength);
+
+		ssize_t const delta = newLength - (to - from);
+		for(auto const& group : groups)
+		{
+			entries_t tmp;
+			for(auto const& pair : group)
+			{
+				if(pair.first < from)
+					tmp.push_back(pair);
+				else if(to <= pair.first)
+					tmp.emplace_back(pair.first + delta, pair.second);
+			}
+
+			if(!tmp.empty())
+				insert(tmp);
+		}
+	}
+
+	void scope_runs_t::remap (std::function<bool(ssize_t, ssize_t&)> const& mapper)
+	{
+		std::vector<entries_t> groups;
+		for(auto run = _runs.begin(); run != _runs.end(); ++run)
+		{
+			entries_t tmp;
+			for(auto const& entry : run->second->entries)
+			{
+				ssize_t key;
+				if(mapper(run->first + entry.offset, key))
+					tmp.emplace_back(key, entry.scope);
+			}
+
+			if(!tmp.empty())
+				groups.push_back(std::move(tmp));
+		}
+
+		_runs.clear();
+		for(auto const& group : groups)
+			insert(group);
+	}
+
+	size_t scope_runs_t::number_of_distinct_runs () const
+	{
+		std::set<run_t const*> res;
+		for(auto run = _runs.begin(); run != _runs.end(); ++run)
+			res.insert(run->second.get());
+		return res.size();
+	}
+
+	scope_runs_t::scope_id_t scope_runs_t::scope_id (scope::scope_t const& scope)
+	{
+		auto it = _scope_ids.find(scope);
+		if(it == _scope_ids.end())
+		{
+			it = _scope_ids.emplace(scope, _scopes.size()).first;
+			_scopes.push_back(scope);
+		}
+		return it->second;
+	}
+
+	scope_runs_t::runs_t::iterator scope_runs_t::run_containing (ssize_t pos) const
+	{
+		auto it = _runs.upper_bound(pos);
+		return it == _runs.begin() ? _runs.end() : --it;
+	}
+
+	void scope_runs_t::entries (runs_t::iterator const& run, entries_t& out) const
+	{
+		for(auto const& entry : run->second->entries)
+			out.emplace_back(run->first + entry.offset, entry.scope);
+	}
+
+	// Removes all runs with an entry in [from, to) (or [from, to] when ‘inclusive’) and returns their entries, one group per run
+	std::vector<scope_runs_t::entries_t> scope_runs_t::extract (ssize_t from, ssize_t to, bool inclusive)
+	{
+		std::vector<entries_t> res;
+		std::vector<ssize_t> keys;
+
+		auto run = _runs.upper_bound(from);
+		if(run != _runs.begin())
+		{
+			auto prev = run;
+			--prev;
+			if(from <= prev->first + (ssize_t)prev->second->entries.back().offset)
+				run = prev;
+		}
+
+		for(; run != _runs.end() && (run->first < to || (inclusive && run->first == to)); ++run)
+		{
+			res.emplace_back();
+			entries(run, res.back());
+			keys.push_back(run->first);
+		}
+
+		riterate(key, keys)
+			_runs.remove(*key);
+
+		return res;
+	}
+
+	// Entries must be sorted and not interleave with existing runs
+	void scope_runs_t::insert (entries_t const& entries)
+	{
+		auto first = entries.begin();
+		while(first != entries.end())
+		{
+			auto last = first;
+			while(last != entries.end() && last->first - first->first <= UINT32_MAX)
+				++last;
+			_runs.set(first->first, intern(first, last));
+			first = last;
+		}
+	}
+
+	scope_runs_t::run_ptr scope_runs_t::intern (entries_t::const_iterator first, entries_t::const_iterator last)
+	{
+		auto run = std::make_shared<run_t>();
+		run->entries.reserve(last - first);
+		for(auto it = first; it != last; ++it)
+		{
+			run_t::entry_t const entry = { (uint32_t)(it->first - first->first), it->second };
+			if(!run->entries.empty() && run->entries.back().offset == entry.offset)
+					run->entries.back() = entry;
+			else	run->entries.push_back(entry);
+		}
+
+		size_t hash = run->entries.size();
+		for(auto const& entry : run->entries)
+			hash = (hash ^ (((size_t)entry.offset << 32) | entry.scope)) * 0x100000001b3;
+		run->hash = hash;
+
+		auto it = _pool.find(hash);
+		if(it != _pool.end())
+		{
+			if(run_ptr existing = it->second.lock())
+			{
+				if(existing->entries == run->entries)
+					return existing;
+				return run; // hash collision, leave the pooled run alone
+			}
+			it->second = run;
+			return run;
+		}
+
+		_pool.emplace(hash, run);
+		if(_pool.size() > _purge_threshold)
+		{
+			for(auto pooled = _pool.begin(); pooled != _pool.end(); )
+			{
+				if(pooled->second.expired())
+						pooled = _pool.erase(pooled);
+				else	++pooled;
+			}
+			_purge_threshold = std::max<size_t>(1024, 2 * _pool.size());
+		}
+		return run;
+	}
+
+} /* ng */
@@ -0,0 +1,108 @@
+#ifndef SCOPE_RUNS_H_7HX3KQ2D
+#define SCOPE_RUNS_H_7HX3KQ2D
+
+#include "indexed_map.h"
+#include <scope/src/scope.h>
+
+namespace ng
+{
+	// Maps buffer positions to the scope starting at that position, with the
+	// same iterator interface as indexed_map_t<scope::scope_t>.
+	//
+	// Entries are grouped in runs (normally one per line as produced by the
+	// parser) stored as arrays of (offset, scope id) relative to the first
+	// entry. Runs are immutable and interned so lines with the same pattern
+	// of scopes share a single array, and scopes are stored once per buffer.
+
+	struct scope_runs_t
+	{
+		typedef uint32_t scope_id_t;
+
+		struct run_t
+		{
+			struct entry_t
+			{
+				uint32_t offset;
+				scope_id_t scope;
+
+				bool operator== (entry_t const& rhs) const { return offset == rhs.offset && scope == rhs.scope; }
+			};
+
+			std::vector<entry_t> entries;
+			size_t hash;
+		};
+
+		typedef std::shared_ptr<run_t const> run_ptr;
+		typedef indexed_map_t<run_ptr> runs_t;
+
+		struct iterator
+		{
+			typedef std::bidirectional_iterator_tag iterator_category;
+			typedef std::pair<ssize_t, scope::scope_t> value_type;
+			typedef ptrdiff_t difference_type;
+			typedef value_type* pointer;
+			typedef value_type& reference;
+
+			iterator (scope_runs_t const& runs, runs_t::iterator const& base, size_t index = 0) : _runs(&runs), _base(base), _index(index) { update_value(); }
+
+			bool operator== (iterator const& rhs) const { return _base == rhs._base && _index == rhs._index; }
+			bool operator!= (iterator const& rhs) const { return !(*this == rhs); }
+			iterator& operator++ ();
+			iterator& operator-- ();
+
+			std::pair<ssize_t, scope::scope_t> const* operator-> () const { return &_value; }
+			std::pair<ssize_t, scope::scope_t> const& operator* () const  { return _value; }
+
+		private:
+			void update_value ();
+
+			scope_runs_t const* _runs;
+			runs_t::iterator _base;
+			size_t _index;
+			std::pair<ssize_t, scope::scope_t> _value;
+		};
+
+		bool empty () const { return _runs.empty(); }
+		void clear ();
+
+		iterator begin () const;
+		iterator end () const;
+		iterator find (ssize_t key) const;
+		iterator lower_bound (ssize_t key) const;
+		iterator upper_bound (ssize_t key) const;
+
+		void set (ssize_t pos, scope::scope_t const& scope);
+
+		// Replace all entries in [from, to) with ‘scopes’ (keys relative to ‘from’)
+		void assign (ssize_t from, ssize_t to, std::map<size_t, scope::scope_t> const& scopes);
+
+		// Same key mapping as indexed_map_t::replace() with bindRight = true
+		void replace (ssize_t from, ssize_t to, size_t newLength);
+
+		// Calls ‘mapper’ with all keys in ascending order. It returns false to drop the entry, otherwise stores the (non-decreasing) new key in its second argument
+		void remap (std::function<bool(ssize_t, ssize_t&)> const& mapper);
+
+		size_t number_of_runs () const     { return _runs.size(); }
+		size_t number_of_distinct_runs () const;
+
+	private:
+		typedef std::vector<std::pair<ssize_t, scope_id_t>> entries_t;
+
+		scope_id_t scope_id (scope::scope_t const& scope);
+		runs_t::iterator run_containing (ssize_t pos) const;
+		iterator bound (ssize_t key, bool upper) const;
+		void entries (runs_t::iterator const& run, entries_t& out) const;
+		std::vector<entries_t> extract (ssize_t from, ssize_t to, bool inclusive);
+		void insert (entries_t const& entries);
+		run_ptr intern (entries_t::const_iterator first, entries_t::const_iterator last);
+
+		runs_t _runs;
+		std::vector<scope::scope_t> _scopes;
+		std::map<scope::scope_t, scope_id_t> _scope_ids;
+		std::map<size_t, std::weak_ptr<run_t const>> _pool; // keyed on run_t::hash
+		size_t _purge_threshold = 1024;
+	};
+
+} /* ng */
+
+#endif /* end of include guard: SCOPE_RUNS_H_7HX3KQ2D */
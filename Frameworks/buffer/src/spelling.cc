@@ -2,20 +2,206 @@
 #include <bundles/src/bundles.h>
 #include <oak/oak.h>
 #include <text/src/my_ctype.h>
-#include <oak/duration.h>
+#include <text/src/utf8.h>
 #include <ns/src/spellcheck.h>
 #include <oak/debug.h>
+#include <atomic>
+#include <string_view>
+
+namespace
+{
+	static bool spell_checking_enabled (scope::scope_t const& scope)
+	{
+		bundles::item_ptr spellCheckingItem;
+		plist::any_t const& spellCheckingValue = bundles::value_for_setting("spellChecking", scope, &spellCheckingItem);
+		return !spellCheckingItem || plist::is_true(spellCheckingValue);
+	}
+
+	static bundles::settings_cache_t<scope::scope_t, bool>& spell_checking_cache ()
+	{
+		static auto* cache = new bundles::settings_cache_t<scope::scope_t, bool>(&spell_checking_enabled);
+		return *cache;
+	}
+
+	static dispatch_queue_t spelling_queue ()
+	{
+		static dispatch_queue_t res = dispatch_queue_create("org.textmate.spelling", DISPATCH_QUEUE_SERIAL);
+		return res;
+	}
+
+	// A batch covers at most this much text (rounded up to a full line) so that opening a large document does not hold up results for edits made meanwhile
+	static size_t const kMaxBatchSize = 64*1024;
+	static size_t const kMaxKnownWords = 8192;
+
+	static uint32_t code_point (std::string const& str, size_t i, size_t& len)
+	{
+		len = std::min(utf8::multibyte<char>::length(str[i]), str.size() - i);
+		return (unsigned char)str[i] < 0x80 ? str[i] : utf8::to_ch(str.substr(i, len));
+	}
+
+	// Calls ‘f’ with [from, to) of each word in ‘str’. An apostrophe between word characters is part of the word (“don’t”) and words without letters (“42”) are skipped
+	template <typename F> void each_word (std::string const& str, F f)
+	{
+		size_t bow = SIZE_T_MAX, len, nextLen;
+		bool hasLetter = false;
+		for(size_t i = 0; i < str.size(); i += len)
+		{
+			uint32_t const ch = code_point(str, i, len);
+			if(text::is_word_char(ch))
+			{
+				if(bow == SIZE_T_MAX)
+				{
+					bow = i;
+					hasLetter = false;
+				}
+				hasLetter = hasLetter || ch >= 0x80 || isalpha(ch);
+			}
+			else if(bow != SIZE_T_MAX)
+			{
+				bool const isApostrophe = ch == '\'' || ch == 0x2019;
+				if(isApostrophe && i + len < str.size() && text::is_word_char(code_point(str, i + len, nextLen)))
+					continue;
+
+				if(hasLetter)
+					f(bow, i);
+				bow = SIZE_T_MAX;
+			}
+		}
+
+		if(bow != SIZE_T_MAX && hasLetter)
+			f(bow, str.size());
+	}
+
+	// =========================
+	// = Spelling Dictionaries =
+	// =========================
+
+	struct system_dictionary_t : ng::spelling_dictionary_t
+	{
+		// All words go to the spell checker as a single space-separated string, results are mapped back to the word they start in
+		std::vector<bool> misspelled (std::vector<std::string> const& words, std::string const& language, ns::spelling_tag_t const& tag) const
+		{
+			std::string str;
+			std::vector<size_t> offsets;
+			for(auto const& word : words)
+			{
+				offsets.push_back(str.size());
+				str.append(word).append(" ");
+			}
+
+			std::vector<bool> res(words.size(), false);
+			for(auto const& range : ns::spellcheck(str.data(), str.data() + str.size(), language, tag))
+				res[std::upper_bound(offsets.begin(), offsets.end(), range.first) - offsets.begin() - 1] = true;
+			return res;
+		}
+	};
+
+	struct word_list_dictionary_t : ng::spelling_dictionary_t
+	{
+		word_list_dictionary_t (std::vector<std::string> const& words) : _words(words.begin(), words.end()) { }
+
+		std::vector<bool> misspelled (std::vector<std::string> const& words, std::string const& language, ns::spelling_tag_t const& tag) const
+		{
+			std::vector<bool> res;
+			for(auto const& word : words)
+				res.push_back(_words.find(word) == _words.end());
+			return res;
+		}
+
+	private:
+		std::set<std::string> _words;
+	};
+}
 
 namespace ng
 {
+	spelling_dictionary_ptr system_spelling_dictionary ()
+	{
+		static spelling_dictionary_ptr const res = std::make_shared<system_dictionary_t>();
+		return res;
+	}
+
+	spelling_dictionary_ptr word_list_spelling_dictionary (std::vector<std::string> const& words)
+	{
+		return std::make_shared<word_list_dictionary_t>(words);
+	}
+
+	// ===========
+	// = batch_t =
+	// ===========
+
+	struct spelling_t::batch_t
+	{
+		batch_t () : group(dispatch_group_create()) { }
+		~batch_t () { dispatch_release(group); }
+
+		// Runs on the spelling queue: Each distinct word not in the known words is sent to the dictionary once
+		void check ()
+		{
+			if(known_words->size() > kMaxKnownWords)
+				known_words->clear();
+
+			struct occurrence_t
+			{
+				size_t range, from, to;
+				std::string_view word;
+			};
+
+			std::vector<occurrence_t> occurrences;
+			std::set<std::string_view> seen;
+			std::vector<std::string> unknown;
+			for(size_t i = 0; i < input.size(); ++i)
+			{
+				for(auto const& piece : input[i])
+				{
+					each_word(piece.second, [&](size_t from, size_t to){
+						std::string_view const word(piece.second.data() + from, to - from);
+						if(known_words->find(word) == known_words->end() && seen.insert(word).second)
+							unknown.emplace_back(word);
+						occurrences.push_back({ i, piece.first + from, piece.first + to, word });
+					});
+				}
+			}
+
+			if(!unknown.empty())
+			{
+				std::vector<bool> const misspelled = dictionary->misspelled(unknown, language, tag);
+				for(size_t i = 0; i < unknown.size(); ++i)
+					known_words->emplace(unknown[i], i < misspelled.size() && misspelled[i]);
+			}
+
+			output.resize(input.size());
+			for(auto const& occurrence : occurrences)
+			{
+				if(known_words->find(occurrence.word)->second)
+					output[occurrence.range].emplace_back(occurrence.from, occurrence.to);
+			}
+		}
+
+		std::vector<std::pair<size_t, size_t>> ranges; // Main thread only, kept current by spelling_t::replace()
+		std::vector<std::vector<std::pair<size_t, std::string>>> input; // Per range: Text where spell checking is enabled with its offset relative to the range
+		std::vector<std::vector<std::pair<size_t, size_t>>> output;     // Per range: Misspelled words relative to the range
+		std::string language;
+		ns::spelling_tag_t tag;
+		spelling_dictionary_ptr dictionary;
+		std::shared_ptr<known_words_t> known_words;
+		std::atomic<bool> done { false };
+		dispatch_group_t group;
+	};
+
+	spelling_t::spelling_t () : _known_words(std::make_shared<known_words_t>()), _reference(std::make_shared<bool>(true)) { }
+	spelling_t::~spelling_t () { }
+
 	bool spelling_t::misspelled_at (size_t i) const
 	{
 		tree_t::iterator it = _misspellings.upper_bound(i);
 		return it != _misspellings.begin() ? (--it)->second : false;
 	}
 
-	std::pair<size_t, size_t> spelling_t::next_misspelling (size_t from) const
+	std::pair<size_t, size_t> spelling_t::next_misspelling (buffer_t const* buffer, size_t from) const
 	{
+		wait(buffer);
+
 		tree_t::iterator it = _misspellings.upper_bound(from);
 		if(it == _misspellings.end())
 			it = _misspellings.begin();
@@ -33,70 +219,190 @@ namespace ng
 
 	void spelling_t::did_parse (buffer_t const* buffer, size_t from, size_t to)
 	{
-		auto first = buffer->_scopes.lower_bound(from);
-		auto last  = buffer->_scopes.upper_bound(to);
-		if(first != buffer->_scopes.begin() && from < first->first)
-			--from;
+		_dirty.emplace_back(from, to);
+		schedule(buffer);
+	}
+
+	// Coalesces the parse callbacks of a run loop cycle into one batch
+	void spelling_t::schedule (buffer_t const* buffer) const
+	{
+		if(_scheduled || _batch)
+			return;
+		_scheduled = true;
+
+		std::weak_ptr<bool> reference = _reference;
+		CFRunLoopRef runLoop = CFRunLoopGetCurrent();
+		CFRunLoopPerformBlock(runLoop, kCFRunLoopCommonModes, ^{
+			if(reference.lock())
+				flush(buffer);
+		});
+		CFRunLoopWakeUp(runLoop);
+	}
 
-		std::set<scope::scope_t> enabled, disabled;
-		for(auto pair = first; pair != last; ++pair)
+	void spelling_t::flush (buffer_t const* buffer) const
+	{
+		_scheduled = false;
+		if(_batch || _dirty.empty())
+			return;
+
+		std::sort(_dirty.begin(), _dirty.end());
+		std::vector<std::pair<size_t, size_t>> ranges;
+		for(auto const& range : _dirty)
 		{
-			if(enabled.find(pair->second) != enabled.end() || disabled.find(pair->second) != disabled.end())
-				continue;
-			bundles::item_ptr spellCheckingItem;
-			plist::any_t const& spellCheckingValue = bundles::value_for_setting("spellChecking", pair->second, &spellCheckingItem);
-			if(spellCheckingItem && !plist::is_true(spellCheckingValue))
-					disabled.insert(pair->second);
-			else	enabled.insert(pair->second);
+			if(!ranges.empty() && range.first <= ranges.back().second)
+					ranges.back().second = std::max(ranges.back().second, range.second);
+			else	ranges.push_back(range);
 		}
+		_dirty.clear();
 
-		std::vector< std::pair<size_t, size_t> > ranges;
-		while(first != last)
+		auto batch = std::make_shared<batch_t>();
+		size_t batchSize = 0;
+		for(auto const& range : ranges)
 		{
-			scope::scope_t scope = first->second;
-			size_t i = std::max<ssize_t>(from, first->first);
-			size_t j = ++first == last ? to : first->first;
+			size_t from = std::min(range.first, buffer->size());
+			size_t to   = std::min(range.second, buffer->size());
+			if(batchSize >= kMaxBatchSize)
+			{
+				_dirty.emplace_back(from, to);
+				continue;
+			}
 
-			if(enabled.find(scope) != enabled.end())
+			if(to - from > kMaxBatchSize - batchSize)
 			{
-				if(ranges.empty() || ranges.back().second != i)
-						ranges.emplace_back(i, j);
-				else	ranges.back().second = j;
+				size_t const eol = buffer->end(buffer->convert(from + kMaxBatchSize - batchSize).line);
+				if(eol < to)
+				{
+					_dirty.emplace_back(eol, to);
+					to = eol;
+				}
 			}
+
+			std::vector<std::pair<size_t, std::string>> pieces;
+			auto scope = buffer->_scopes.upper_bound(from);
+			if(scope != buffer->_scopes.begin())
+				--scope;
+			while(scope != buffer->_scopes.end() && scope->first < (ssize_t)to)
+			{
+				size_t const i = std::max<ssize_t>(from, scope->first);
+				bool const enabled = spell_checking_cache().lookup(scope->second);
+				size_t const j = ++scope == buffer->_scopes.end() || (ssize_t)to < scope->first ? to : scope->first;
+				if(!enabled || i == j)
+					continue;
+
+				if(!pieces.empty() && pieces.back().first + pieces.back().second.size() == i - from)
+						pieces.back().second += buffer->substr(i, j);
+				else	pieces.emplace_back(i - from, buffer->substr(i, j));
+			}
+
+			batch->ranges.emplace_back(from, to);
+			batch->input.push_back(std::move(pieces));
+			batchSize += to - from;
 		}
 
-		// TODO We should delay checking to the misspellings function. This way we won’t spell check entire document on load etc.
-		auto fromIter = _misspellings.lower_bound(from);
-		auto toIter   = _misspellings.upper_bound(to);
-		if(fromIter != toIter && fromIter->first >= to && fromIter->second)
-			fromIter = toIter;
-		_misspellings.remove(fromIter, toIter);
+		if(batch->ranges.empty())
+			return;
+
+		batch->language    = buffer->spelling_language();
+		batch->tag         = buffer->spelling_tag();
+		batch->dictionary  = buffer->spelling_dictionary();
+		batch->known_words = _known_words;
+		(void)(long int)batch->tag; // Setup the tag here as doing so from the spelling queue would wait for the main thread
 
-		if(_disabled)
+		_batch = batch;
+
+		std::weak_ptr<bool> reference = _reference;
+		CFRunLoopRef runLoop = CFRunLoopGetCurrent();
+		dispatch_group_async(batch->group, spelling_queue(), ^{
+			batch->check();
+			batch->done.store(true, std::memory_order_release);
+
+			CFRunLoopPerformBlock(runLoop, kCFRunLoopCommonModes, ^{
+				if(reference.lock())
+					merge(buffer);
+			});
+			CFRunLoopWakeUp(runLoop);
+		});
+	}
+
+	void spelling_t::merge (buffer_t const* buffer) const
+	{
+		if(!_batch || !_batch->done.load(std::memory_order_acquire))
 			return;
 
-		size_t revision = buffer->revision();
-		for(auto const& r : ranges)
+		auto batch = _batch;
+		_batch.reset();
+
+		size_t updateFrom = SIZE_T_MAX, updateTo = 0;
+		for(size_t i = 0; i < batch->ranges.size(); ++i)
 		{
-			std::string const& text = buffer->substr(r.first, r.second);
-			for(auto const& range : ns::spellcheck(text.data(), text.data() + text.size(), buffer->spelling_language(), buffer->spelling_tag()))
-			{
-				if(revision != buffer->revision())
-				{
-					os_log_error(OS_LOG_DEFAULT, "Buffer has changed after ns::spellcheck()");
-					break;
-				}
+			size_t const from = batch->ranges[i].first, to = batch->ranges[i].second;
+			if(from == SIZE_T_MAX)
+				continue;
 
-				_misspellings.set(r.first + range.first, true);
-				_misspellings.set(r.first + range.last,  false);
+			auto fromIter = _misspellings.lower_bound(from);
+			auto toIter   = _misspellings.upper_bound(to);
+			if(fromIter != toIter && fromIter->first >= to && fromIter->second)
+				fromIter = toIter;
+			_misspellings.remove(fromIter, toIter);
+
+			for(auto const& word : batch->output[i])
+			{
+				_misspellings.set(from + word.first,  true);
+				_misspellings.set(from + word.second, false);
 			}
+
+			updateFrom = std::min(updateFrom, from);
+			updateTo   = std::max(updateTo, to);
+		}
+
+		if(updateFrom < updateTo)
+			buffer->_callbacks(&callback_t::did_update_spelling, updateFrom, updateTo);
+
+		flush(buffer);
+	}
+
+	void spelling_t::wait (buffer_t const* buffer) const
+	{
+		flush(buffer);
+		while(_batch)
+		{
+			dispatch_group_wait(_batch->group, DISPATCH_TIME_FOREVER);
+			merge(buffer);
 		}
 	}
 
 	void spelling_t::replace (buffer_t* buffer, size_t from, size_t to, size_t len)
 	{
-		// TODO We need to keep a list of dirty ranges to minimize work done in did_parse — these ranges should be extended to “surrounding words”, e.g. if user inserts space into “sho‸rtcut” we need to re-check “sho” even though it is not included in the changed range.
 		_misspellings.replace(from, to, len);
+
+		// Dirty ranges touching the edit grow to include the new text
+		auto shift = [&](size_t pos, bool end) -> size_t {
+			if(pos < from)
+				return pos;
+			else if(pos <= to)
+				return end ? from + len : from;
+			return pos + len - (to - from);
+		};
+
+		for(auto& range : _dirty)
+			range = std::make_pair(shift(range.first, false), shift(range.second, true));
+
+		if(_batch)
+		{
+			for(auto& range : _batch->ranges)
+			{
+				if(range.first == SIZE_T_MAX)
+					continue;
+
+				bool const overlaps = range.first <= to && from <= range.second;
+				range = std::make_pair(shift(range.first, false), shift(range.second, true));
+				if(overlaps)
+				{
+					_dirty.push_back(range);
+					range = std::make_pair(SIZE_T_MAX, SIZE_T_MAX);
+				}
+			}
+		}
 	}
 
 	std::map<size_t, bool> spelling_t::misspellings (buffer_t const* buffer, size_t from, size_t to) const
@@ -112,6 +418,7 @@ namespace ng
 
 	void spelling_t::recheck (buffer_t const* buffer, size_t from, size_t to)
 	{
+		_known_words = std::make_shared<known_words_t>(); // The language, dictionary, or learned words may have changed
 		did_parse(buffer, from, to);
 	}
 
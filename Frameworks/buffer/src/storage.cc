@@ -10,7 +10,7 @@ namespace ng
 		// ============
 
 		template <typename _InputIter>
-		memory_t::memory_t (_InputIter first, _InputIter last) : _helper(std::make_shared<helper_t>(first, last)), _offset(0) { }
+		memory_t::memory_t (_InputIter first, _InputIter last, size_t capacity) : _helper(std::make_shared<helper_t>(first, last, capacity)), _offset(0) { }
 
 		template <typename _InputIter>
 		void memory_t::insert (size_t pos, _InputIter first, _InputIter last)
@@ -75,7 +75,7 @@ namespace ng
 				}
 			}
 
-			_tree.insert(it, length, memory_t(data, data + length));
+			_tree.insert(it, length, memory_t(data, data + length, std::exchange(_capacity_hint, 0)));
 		}
 
 		void storage_t::erase (size_t first, size_t last)
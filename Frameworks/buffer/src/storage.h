@@ -13,9 +13,9 @@ namespace ng
 			struct helper_t
 			{
 				template <typename _InputIter>
-				helper_t (_InputIter first, _InputIter last)
+				helper_t (_InputIter first, _InputIter last, size_t capacity = 0)
 				{
-					_bytes = (char*)malloc(std::distance(first, last) + 15);
+					_bytes = (char*)malloc(std::max<size_t>(std::distance(first, last), capacity) + 15);
 					append(first, last);
 				}
 
@@ -39,7 +39,7 @@ namespace ng
 			typedef std::shared_ptr<helper_t> helper_ptr;
 
 			template <typename _InputIter>
-			memory_t (_InputIter first, _InputIter last);
+			memory_t (_InputIter first, _InputIter last, size_t capacity = 0);
 
 			memory_t () : _offset(0)                          { }
 			memory_t (helper_ptr const& helper, size_t offset) : _helper(helper), _offset(offset) { }
@@ -114,12 +114,14 @@ namespace ng
 
 			void insert (size_t pos, char const* data, size_t length);
 			void erase (size_t first, size_t last);
+			void reserve (size_t capacity) { _capacity_hint = capacity; } // next chunk allocated by insert() will have room for this many bytes
 			char operator[] (size_t i) const;
 			std::string substr (size_t first, size_t last) const;
 
 		private:
 			typedef oak::basic_tree_t<size_t, memory_t> tree_t;
 			mutable tree_t _tree;
+			size_t _capacity_hint = 0;
 			tree_t::iterator split_at (tree_t::iterator, size_t pos);
 			tree_t::iterator find_pos (size_t pos) const;
 		};
@@ -4,6 +4,7 @@
 #include <oak/oak.h>
 #include <text/src/my_ctype.h>
 #include <oak/duration.h>
+#include <atomic>
 
 namespace
 {
@@ -67,13 +68,14 @@ namespace
 
 		std::string expand (std::string const& str) const
 		{
-			static regexp::pattern_t newline("\n");
-			std::string res = replace(str, newline, format_string::format_string_t(" "));
+			static regexp::pattern_t const newline("\n");
+			static format_string::format_string_t const space(" "), returnSymbol("↵");
+
+			bool const hasNewline = str.find('\n') != std::string::npos;
+			std::string res = hasNewline ? replace(str, newline, space) : str;
 			for(auto const& it : records)
 				res = replace(res, it.regexp, it.format, it.repeat);
-			res = replace(res, newline, format_string::format_string_t("↵"));
-
-			return res;
+			return res.find('\n') != std::string::npos ? replace(res, newline, returnSymbol) : res;
 		}
 	private:
 		static bool parse_char (char const*& it, char const* last, char ch)
@@ -91,57 +93,171 @@ namespace
 		std::string src;
 		std::vector<record_t> records;
 	};
+
+	typedef std::shared_ptr<transform_t const> transform_ptr;
+
+	// Returns a null pointer for scopes that should not appear in the symbol list
+	static transform_ptr transform_for_scope (scope::scope_t const& scope)
+	{
+		if(!plist::is_true(bundles::value_for_setting("showInSymbolList", scope)))
+			return transform_ptr();
+
+		plist::any_t const& symbolTransformationValue = bundles::value_for_setting("symbolTransformation", scope);
+		std::string const* symbolTransformation = boost::get<std::string>(&symbolTransformationValue);
+		return std::make_shared<transform_t>(symbolTransformation ? *symbolTransformation : "");
+	}
+
+	static bundles::settings_cache_t<scope::scope_t, transform_ptr>& transform_cache ()
+	{
+		static auto* cache = new bundles::settings_cache_t<scope::scope_t, transform_ptr>(&transform_for_scope);
+		return *cache;
+	}
+
+	// When a parse callback yields fewer symbols than this we expand them in place
+	static size_t const kAsyncSymbolThreshold = 32;
 }
 
 namespace ng
 {
-	void symbols_t::replace (buffer_t* buffer, size_t from, size_t to, size_t len) { _symbols.replace(from, to, len); }
+	// ===========
+	// = batch_t =
+	// ===========
 
-	void symbols_t::did_parse (buffer_t const* buffer, size_t from, size_t to)
+	struct symbols_t::batch_t
 	{
-		_symbols.remove(_symbols.lower_bound(from), _symbols.lower_bound(to));
+		batch_t () : group(dispatch_group_create()) { }
+		~batch_t () { dispatch_release(group); }
 
-		std::set<scope::scope_t> all_scopes;
-		foreach(it, buffer->_scopes.lower_bound(from), buffer->_scopes.lower_bound(to))
-			all_scopes.insert(all_scopes.end(), it->second);
+		std::vector<size_t> positions; // Main thread only, kept current by symbols_t::replace()
+		std::vector<std::pair<std::string, transform_ptr>> input;
+		std::vector<std::string> output;
+		std::atomic<bool> done { false };
+		dispatch_group_t group;
+	};
+
+	symbols_t::symbols_t () : _reference(std::make_shared<bool>(true)) { }
+	symbols_t::~symbols_t () { }
+
+	bool symbols_t::merge (bool wait) const
+	{
+		size_t i = 0;
+		for(; i < _pending.size(); ++i)
+		{
+			batch_t& batch = *_pending[i];
+			if(wait)
+				dispatch_group_wait(batch.group, DISPATCH_TIME_FOREVER);
+			else if(!batch.done.load(std::memory_order_acquire))
+				break;
+
+			for(size_t j = 0; j < batch.positions.size(); ++j)
+			{
+				if(batch.positions[j] != SIZE_T_MAX)
+					_symbols.set(batch.positions[j], batch.output[j]);
+			}
+		}
+		_pending.erase(_pending.begin(), _pending.begin() + i);
+		return i != 0;
+	}
+
+	void symbols_t::wait (buffer_t const* buffer) const
+	{
+		if(merge(true))
+			buffer->_callbacks(&callback_t::did_update_symbols);
+	}
+
+	void symbols_t::replace (buffer_t* buffer, size_t from, size_t to, size_t len)
+	{
+		_symbols.replace(from, to, len);
+
+		for(auto const& batch : _pending)
+		{
+			for(auto& pos : batch->positions)
+			{
+				if(pos == SIZE_T_MAX || pos < from)
+					continue;
+				else if(pos < to)
+					pos = SIZE_T_MAX;
+				else
+					pos = pos + len - (to - from);
+			}
+		}
+	}
+
+	void symbols_t::did_parse (buffer_t const* buffer, size_t from, size_t to)
+	{
+		merge(false);
 
-		std::map<scope::scope_t, transform_t> transforms;
-		for(auto const& it : all_scopes)
+		_symbols.remove(_symbols.lower_bound(from), _symbols.lower_bound(to));
+		for(auto const& batch : _pending)
 		{
-			if(plist::is_true(bundles::value_for_setting("showInSymbolList", it)))
+			for(auto& pos : batch->positions)
 			{
-				plist::any_t const& symbolTransformationValue = bundles::value_for_setting("symbolTransformation", it);
-				std::string const* symbolTransformation = boost::get<std::string>(&symbolTransformationValue);
-				transforms.emplace(it, transform_t(symbolTransformation ? *symbolTransformation : ""));
+				if(from <= pos && pos < to)
+					pos = SIZE_T_MAX;
 			}
 		}
 
+		auto batch = std::make_shared<batch_t>();
+
 		size_t beginOfSymbol = 0;
-		bool inSymbol = false;
-		transform_t* transform = nullptr;
+		transform_ptr transform;
 		foreach(it, buffer->_scopes.lower_bound(from), buffer->_scopes.lower_bound(to))
 		{
-			std::map<scope::scope_t, transform_t>::iterator transformIt = transforms.find(it->second);
-			if(transformIt != transforms.end())
+			if(transform_ptr scopeTransform = transform_cache().lookup(it->second))
 			{
-				if(!inSymbol)
+				if(!transform)
 					beginOfSymbol = it->first;
-				transform = &transformIt->second;
-				inSymbol  = true;
+				transform = scopeTransform;
 			}
-			else if(inSymbol)
+			else if(transform)
 			{
-				_symbols.set(beginOfSymbol, transform->expand(buffer->substr(beginOfSymbol, it->first)));
-				inSymbol = false;
+				batch->positions.push_back(beginOfSymbol);
+				batch->input.emplace_back(buffer->substr(beginOfSymbol, it->first), transform);
+				transform.reset();
 			}
 		}
 
-		if(inSymbol)
-			_symbols.set(beginOfSymbol, transform->expand(buffer->substr(beginOfSymbol, to)));
+		if(transform)
+		{
+			batch->positions.push_back(beginOfSymbol);
+			batch->input.emplace_back(buffer->substr(beginOfSymbol, to), transform);
+		}
+
+		if(batch->input.empty())
+			return;
+
+		if(batch->input.size() < kAsyncSymbolThreshold)
+		{
+			for(size_t i = 0; i < batch->input.size(); ++i)
+				_symbols.set(batch->positions[i], batch->input[i].second->expand(batch->input[i].first));
+			return;
+		}
+
+		batch->output.resize(batch->input.size());
+
+		std::weak_ptr<bool> reference = _reference;
+		CFRunLoopRef runLoop = CFRunLoopGetCurrent();
+		dispatch_group_async(batch->group, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+			size_t const stride = 64;
+			dispatch_apply((batch->input.size() + stride - 1) / stride, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t n){
+				for(size_t i = n * stride; i < std::min((n + 1) * stride, batch->input.size()); ++i)
+					batch->output[i] = batch->input[i].second->expand(batch->input[i].first);
+			});
+			batch->done.store(true, std::memory_order_release);
+
+			CFRunLoopPerformBlock(runLoop, kCFRunLoopCommonModes, ^{
+				if(reference.lock() && merge(false))
+					buffer->_callbacks(&callback_t::did_update_symbols);
+			});
+			CFRunLoopWakeUp(runLoop);
+		});
+		_pending.push_back(batch);
 	}
 
 	std::map<size_t, std::string> symbols_t::symbols (buffer_t const* buffer) const
 	{
+		merge(false);
+
 		std::map<size_t, std::string> res;
 		for(auto const& it : _symbols)
 			res.insert(it);
@@ -150,6 +266,8 @@ namespace ng
 
 	std::string symbols_t::symbol_at (buffer_t const* buffer, size_t i) const
 	{
+		merge(false);
+
 		tree_t::iterator it = _symbols.upper_bound(i);
 		if(it == _symbols.begin())
 			return NULL_STR;
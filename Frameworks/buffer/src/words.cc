@@ -0,0 +1,345 @@
+#include "meta_data.h"
+#include <bundles/src/bundles.h>
+#include <text/src/my_ctype.h>
+#include <text/src/utf8.h>
+#include <oak/oak.h>
+#include <string_view>
+
+namespace
+{
+	// Same classification as ng::character_class(): A word is a run of characters with the same class, where the class is neither space nor other
+	struct word_class_t
+	{
+		word_class_t (std::string const* characterClass, std::string const& wordCharacters) : _word_characters(wordCharacters)
+		{
+			if(characterClass)
+			{
+				_has_character_class = true;
+				_character_class     = *characterClass;
+				_is_word             = _character_class != "space" && _character_class != "other";
+			}
+		}
+
+		// Returns nullptr when the character at ‘first’ is not part of a word
+		std::string const* classify (char const* first, char const* last) const
+		{
+			static std::string const kWord = "word";
+			if(_has_character_class)
+				return _is_word ? &_character_class : nullptr;
+
+			uint32_t const ch = (unsigned char)*first < 0x80 ? *first : utf8::to_ch(std::string(first, last));
+			if(text::is_word_char(ch) || (!_word_characters.empty() && _word_characters.find(first, 0, last - first) != std::string::npos))
+				return &kWord;
+			return nullptr;
+		}
+
+	private:
+		bool _has_character_class = false;
+		bool _is_word = false;
+		std::string _character_class;
+		std::string _word_characters;
+	};
+
+	typedef std::shared_ptr<word_class_t const> word_class_ptr;
+
+	static word_class_ptr word_class_for_scope (scope::scope_t const& scope)
+	{
+		bundles::item_ptr match;
+		plist::any_t const characterClass = bundles::value_for_setting("characterClass", scope, &match);
+		plist::any_t const wordCharacters = bundles::value_for_setting("wordCharacters", scope);
+		std::string const* wordCharactersStr = boost::get<std::string>(&wordCharacters);
+		return std::make_shared<word_class_t>(match ? boost::get<std::string>(&characterClass) : nullptr, wordCharactersStr ? *wordCharactersStr : "");
+	}
+
+	// A changed generation means existing indexes may be using outdated word characters
+	static bundles::settings_cache_t<scope::scope_t, word_class_ptr>& word_class_cache ()
+	{
+		static auto* cache = new bundles::settings_cache_t<scope::scope_t, word_class_ptr>(&word_class_for_scope);
+		return *cache;
+	}
+
+	// Lines are split into words concurrently when re-indexing more than this many lines
+	static size_t const kParallelLineThreshold = 1024;
+	static size_t const kLinesPerBatch = 256;
+
+	typedef std::vector<std::pair<uint32_t, std::string_view>> line_words_t;
+
+	// ‘classes’ holds (position, word class) for each scope change up to ‘to’, with ‘classes.front().first’ <= ‘from’
+	static line_words_t split_line (char const* str, size_t from, size_t to, std::vector<std::pair<size_t, word_class_ptr>> const& classes)
+	{
+		line_words_t res;
+
+		auto scope = std::upper_bound(classes.begin(), classes.end(), from, [](size_t pos, std::pair<size_t, word_class_ptr> const& rhs){ return pos < rhs.first; });
+		ASSERT(scope != classes.begin());
+		word_class_t const* wordClass = (--scope)->second.get();
+
+		size_t bow = from;
+		std::string const* current = nullptr;
+		for(size_t i = from; i < to; )
+		{
+			while(scope + 1 != classes.end() && (scope + 1)->first <= i)
+				wordClass = (++scope)->second.get();
+
+			size_t const len = std::min(utf8::multibyte<char>::length(str[i - from]), to - i);
+			std::string const* charClass = wordClass->classify(str + i - from, str + i - from + len);
+			if(current && (!charClass || *charClass != *current))
+				res.emplace_back(bow - from, std::string_view(str + bow - from, i - bow));
+			if(charClass && (!current || *charClass != *current))
+				bow = i;
+			current = charClass;
+			i += len;
+		}
+
+		if(current)
+			res.emplace_back(bow - from, std::string_view(str + bow - from, to - bow));
+		return res;
+	}
+}
+
+namespace ng
+{
+	// ==========
+	// = line_t =
+	// ==========
+
+	struct words_t::line_t
+	{
+		struct entry_t
+		{
+			uint32_t offset;
+			uint32_t id;
+		};
+
+		size_t length;
+		bool newline;
+		std::vector<entry_t> entries;
+	};
+
+	words_t::words_t ()  { }
+	words_t::~words_t () { }
+
+	void words_t::replace (buffer_t* buffer, size_t from, size_t to, size_t len)
+	{
+		invalidate(from, to, len);
+	}
+
+	void words_t::did_parse (buffer_t const* buffer, size_t from, size_t to)
+	{
+		invalidate(from, to, to - from); // word characters depend on scope
+	}
+
+	// Drops the lines touching [from, to] and marks where the text is no longer indexed. This does not look at the buffer, as bulk replacements call us after all edits have been applied
+	void words_t::invalidate (size_t from, size_t to, size_t len)
+	{
+		if(!_active)
+			return;
+
+		size_t start = 0;
+		auto first = _lines.upper_bound(from);
+		if(first != _lines.begin())
+		{
+			auto prev = first;
+			--prev;
+
+			size_t const end = prev->first + prev->second->length;
+			if(from < end || (from == end && !prev->second->newline))
+					start = (first = prev)->first;
+			else	start = end;
+		}
+
+		auto last = first;
+		for(; last != _lines.end() && last->first <= to; ++last)
+			forget(*last->second);
+		_lines.remove(first, last);
+
+		_lines.replace(from, to, len, false);
+		_dirty.replace(from, to, len, false);
+		_dirty.set(start, true);
+	}
+
+	void words_t::forget (line_t const& line) const
+	{
+		for(auto const& entry : line.entries)
+		{
+			auto word = _ids[entry.id];
+			if(--word->second.count == 0)
+			{
+				_free_ids.push_back(entry.id);
+				_vocabulary.erase(word);
+			}
+		}
+	}
+
+	void words_t::repair (buffer_t const* buffer) const
+	{
+		size_t const generation = word_class_cache().generation();
+		if(!_active || _generation != generation)
+		{
+			_lines.clear();
+			_dirty.clear();
+			_vocabulary.clear();
+			_ids.clear();
+			_free_ids.clear();
+
+			_dirty.set(0, true);
+			_generation = generation;
+			_active = true;
+		}
+
+		while(!_dirty.empty())
+		{
+			size_t const from = _dirty.begin()->first;
+			auto next = _lines.lower_bound(from);
+			size_t const to = next != _lines.end() ? next->first : buffer->size();
+			_dirty.remove(_dirty.begin(), _dirty.upper_bound(to));
+			if(from < to)
+				index(buffer, from, to);
+		}
+	}
+
+	void words_t::index (buffer_t const* buffer, size_t from, size_t to) const
+	{
+		std::string const text = buffer->substr(from, to);
+
+		std::vector<std::pair<size_t, size_t>> lines;
+		for(size_t bol = 0; bol < text.size(); )
+		{
+			size_t eol = text.find('\n', bol);
+			eol = eol == std::string::npos ? text.size() : eol + 1;
+			lines.emplace_back(bol, eol);
+			bol = eol;
+		}
+
+		std::vector<std::pair<size_t, word_class_ptr>> classes;
+		auto scope = buffer->_scopes.upper_bound(from);
+		classes.emplace_back(from, word_class_cache().lookup((--scope)->second));
+		for(++scope; scope != buffer->_scopes.end() && (size_t)scope->first < to; ++scope)
+			classes.emplace_back(scope->first, word_class_cache().lookup(scope->second));
+
+		auto split = [&](size_t n){
+			size_t const bol = lines[n].first, eol = lines[n].second;
+			size_t const len = eol - bol - (text[eol-1] == '\n' ? 1 : 0);
+			return split_line(text.data() + bol, from + bol, from + bol + len, classes);
+		};
+
+		std::vector<line_words_t> words(lines.size());
+		if(lines.size() < kParallelLineThreshold)
+		{
+			for(size_t n = 0; n < lines.size(); ++n)
+				words[n] = split(n);
+		}
+		else
+		{
+			line_words_t* out = words.data();
+			size_t const numberOfLines = lines.size();
+			dispatch_apply((numberOfLines + kLinesPerBatch - 1) / kLinesPerBatch, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t batch){
+				for(size_t n = batch * kLinesPerBatch; n < std::min((batch + 1) * kLinesPerBatch, numberOfLines); ++n)
+					out[n] = split(n);
+			});
+		}
+
+		for(size_t n = 0; n < lines.size(); ++n)
+		{
+			auto line = std::make_shared<line_t>();
+			line->length  = lines[n].second - lines[n].first;
+			line->newline = text[lines[n].second - 1] == '\n';
+			line->entries.reserve(words[n].size());
+
+			for(auto const& pair : words[n])
+			{
+				auto word = _vocabulary.find(pair.second);
+				if(word == _vocabulary.end())
+				{
+					uint32_t id = _ids.size();
+					if(_free_ids.empty())
+					{
+						_ids.emplace_back();
+					}
+					else
+					{
+						id = _free_ids.back();
+						_free_ids.pop_back();
+					}
+
+					word = _vocabulary.emplace(std::string(pair.second), word_t{ id, 0 }).first;
+					_ids[id] = word;
+				}
+				++word->second.count;
+				line->entries.push_back({ pair.first, word->second.id });
+			}
+
+			_lines.set(from + lines[n].first, line);
+		}
+	}
+
+	std::map<std::string, size_t> words_t::words (buffer_t const* buffer, std::string const& prefix, size_t caret) const
+	{
+		repair(buffer);
+
+		std::vector<bool> candidates(_ids.size(), false);
+		size_t count = 0;
+		for(auto it = _vocabulary.lower_bound(prefix); it != _vocabulary.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it)
+		{
+			candidates[it->second.id] = true;
+			++count;
+		}
+
+		if(count == 0 || _lines.empty())
+			return { };
+
+		// Rank is the same as used by editor_t::completions(), so we scan away from the caret in both directions and keep the first occurrence of each word
+		std::vector<std::pair<ssize_t, size_t>> closest(_ids.size(), std::make_pair(SSIZE_MAX, SIZE_T_MAX));
+
+		auto containing = _lines.upper_bound(caret);
+		if(containing != _lines.begin())
+			--containing;
+
+		std::vector<bool> seen(_ids.size(), false);
+		size_t remaining = count;
+		for(auto line = containing; line != _lines.end() && remaining; ++line)
+		{
+			for(auto const& entry : line->second->entries)
+			{
+				size_t const pos = line->first + entry.offset;
+				if(pos < caret || !candidates[entry.id] || seen[entry.id])
+					continue;
+
+				seen[entry.id] = true;
+				closest[entry.id] = std::make_pair((ssize_t)(pos - caret), pos);
+				if(--remaining == 0)
+					break;
+			}
+		}
+
+		seen.assign(_ids.size(), false);
+		remaining = count;
+		for(auto line = containing; remaining; --line)
+		{
+			riterate(entry, line->second->entries)
+			{
+				size_t const pos = line->first + entry->offset;
+				if(caret <= pos || !candidates[entry->id] || seen[entry->id])
+					continue;
+
+				seen[entry->id] = true;
+				ssize_t const rank = (ssize_t)caret - (ssize_t)(pos + _ids[entry->id]->first.size());
+				if(rank < closest[entry->id].first)
+					closest[entry->id] = std::make_pair(rank, pos);
+				if(--remaining == 0)
+					break;
+			}
+
+			if(line == _lines.begin())
+				break;
+		}
+
+		std::map<std::string, size_t> res;
+		for(uint32_t id = 0; id < closest.size(); ++id)
+		{
+			if(closest[id].second != SIZE_T_MAX)
+				res.emplace(_ids[id]->first, closest[id].second);
+		}
+		return res;
+	}
+
+} /* ng */
@@ -2,6 +2,7 @@
 #import <text/src/format.h>
 #import <test/bundle_index.h>
 #import <oak/duration.h>
+#import <test/benchmark.h>
 
 static bundles::item_ptr TestGrammarItem;
 
@@ -18,8 +19,15 @@ void setup_fixtures ()
 		"	uuid           = '978BF73C-B36D-490F-AEBF-74EF2C6EA7D1';\n"
 		"}\n";
 
+	static std::string TestSymbolSettings =
+		"{	name     = 'Symbol List';"
+		"	scope    = 'bar';"
+		"	settings = { showInSymbolList = 1; symbolTransformation = 's/bar/baz/'; };"
+		"}";
+
 	test::bundle_index_t bundleIndex;
 	TestGrammarItem = bundleIndex.add(bundles::kItemTypeGrammar, TestLanguageGrammar);
+	bundleIndex.add(bundles::kItemTypeSettings, TestSymbolSettings);
 	bundleIndex.commit();
 
 	NSApplicationLoad();
@@ -40,6 +48,26 @@ void benchmark_insert_50_mb ()
 		buf.insert(buf.size(), tmp);
 }
 
+void benchmark_replace_in_5_mb ()
+{
+	std::string line = "The quick brown fox jumps over the lazy dog.\n";
+	std::string text;
+	while(text.size() < 5*1024*1024)
+		text += line;
+
+	ng::buffer_t buf;
+	buf.insert(0, text);
+
+	test::benchmark("buffer.replace", [&](){
+		for(size_t i = 0; i < 1000; ++i)
+		{
+			size_t const pos = arc4random_uniform(buf.size() - 16);
+			buf.replace(pos, pos + 5, "jumps");
+		}
+	});
+	OAK_ASSERT_EQ(buf.size(), text.size());
+}
+
 // void test_copy_constructor ()
 // {
 // 	ng::buffer_t org, dup;
@@ -86,6 +114,39 @@ void test_subset_replace ()
 	buf.remove_callback(&cb);
 }
 
+void test_bulk_replace ()
+{
+	struct callback_t : ng::callback_t
+	{
+		callback_t (ng::buffer_t const& buffer) : buffer(buffer) { }
+		void will_replace_batch (std::vector<ng::replacement_t> const& replacements) { batches.push_back(replacements.size()); }
+		void did_replace (size_t from, size_t to, char const* buf, size_t len)      { replayed.push_back(buffer.substr(from, from + len)); }
+		ng::buffer_t const& buffer;
+		std::vector<size_t> batches;
+		std::vector<std::string> replayed;
+	};
+
+	ng::buffer_t buf;
+	callback_t cb(buf);
+
+	buf.insert(0, "a,b\nc,d\ne,f");
+	buf.insert(buf.size(), "\ng,h");
+	buf.add_callback(&cb);
+
+	buf.replace({ { 1, 2, ";\n" }, { 5, 6, ";" }, { 9, 10, "" }, { 13, 14, "\t" } });
+	OAK_ASSERT_EQ(buf.substr(0, buf.size()), "a;\nb\nc;d\nef\ng\th");
+	OAK_ASSERT_EQ(buf.lines(), 5);
+	OAK_ASSERT_EQ(buf.begin(2), 5);
+	OAK_ASSERT_EQ(buf.begin(4), 12);
+	OAK_ASSERT_EQ(cb.batches.size(), 1);
+	OAK_ASSERT_EQ(cb.batches.back(), 4);
+
+	std::vector<std::string> const expected = { ";\n", ";", "", "\t" };
+	OAK_ASSERT(cb.replayed == expected);
+
+	buf.remove_callback(&cb);
+}
+
 void test_markup ()
 {
 	ng::buffer_t buf;
@@ -104,6 +165,58 @@ void test_xml_markup ()
 	OAK_ASSERT_EQ(buf.xml_substr(6, 13), "<text>&lt;World></text>");
 }
 
+void test_snapshot ()
+{
+	ng::buffer_t buf;
+	buf.insert(0, "Hello <World>");
+
+	ng::snapshot_t const text = buf.snapshot(6, 13);
+	ng::snapshot_t const xml  = buf.snapshot(0, 13, true);
+
+	buf.insert(13, " & Fun");
+	buf.replace(6, 13, "Moon");
+	buf.insert(0, ">> ");
+
+	OAK_ASSERT_EQ(text.str(), "<World>");
+	OAK_ASSERT_EQ(xml.str(), "<text>Hello &lt;World></text>");
+	OAK_ASSERT_EQ(buf.snapshot(0, buf.size()).str(), ">> Hello Moon & Fun");
+}
+
+void test_words ()
+{
+	ng::buffer_t buf;
+	buf.insert(0, "foo fooBar\nbar foo_baz\n");
+
+	OAK_ASSERT(buf.words("fo", 0) == (std::map<std::string, size_t>{ { "foo", 0 }, { "fooBar", 4 }, { "foo_baz", 15 } }));
+	OAK_ASSERT(buf.words("b", 0) == (std::map<std::string, size_t>{ { "bar", 11 } }));
+
+	buf.insert(11, "bazaar ");
+	buf.replace(0, 3, "qux");
+	OAK_ASSERT_EQ(buf.words("foo", 0).count("foo"), 0);
+	OAK_ASSERT(buf.words("ba", 0) == (std::map<std::string, size_t>{ { "bazaar", 11 }, { "bar", 18 } }));
+
+	buf.replace(10, 11, " ");
+	buf.insert(buf.size(), "fooBar");
+	OAK_ASSERT_EQ(buf.words("fooB", 0).at("fooBar"), 4);
+	OAK_ASSERT_EQ(buf.words("fooB", buf.size()).at("fooBar"), 30);
+	OAK_ASSERT_EQ(buf.words("q", 0).at("qux"), 0);
+}
+
+void test_symbols ()
+{
+	ng::buffer_t buf;
+	buf.set_grammar(TestGrammarItem);
+	for(size_t i = 0; i < 100; ++i)
+		buf.insert(buf.size(), "foo bar\n");
+	buf.bump_revision();
+	buf.wait_for_repair();
+	buf.wait_for_symbols();
+
+	OAK_ASSERT_EQ(buf.symbols().size(), 100);
+	OAK_ASSERT_EQ(buf.symbol_at(12), "baz");
+	OAK_ASSERT_EQ(buf.symbol_at(buf.size()), "baz");
+}
+
 void test_spelling ()
 {
 	ng::buffer_t buf;
@@ -113,6 +226,7 @@ void test_spelling ()
 	buf.insert(0, "myfo god\nthat ibs nice\nlamere check\n");
 	buf.bump_revision();
 	buf.wait_for_repair();
+	buf.wait_for_spelling();
 
 	OAK_ASSERT_EQ(buf.misspellings(0, buf.size()).size(), 6);
 
@@ -131,6 +245,7 @@ void test_spelling_2 ()
 	buf.insert(0, "it mq xy");
 	buf.bump_revision();
 	buf.wait_for_repair();
+	buf.wait_for_spelling();
 
 	std::map<size_t, bool> bad = buf.misspellings(0, buf.size());
 	OAK_ASSERT_EQ(bad.size(), 3);
@@ -146,6 +261,7 @@ void test_spelling_3 ()
 	buf.insert(0, "it mq xy");
 	buf.bump_revision();
 	buf.wait_for_repair();
+	buf.wait_for_spelling();
 
 	std::map<size_t, bool> bad = buf.misspellings(4, 7);
 	OAK_ASSERT_EQ(bad.size(), 3);
@@ -162,16 +278,40 @@ void test_spelling_4 ()
 	buf.insert(0, "hxllo world");
 	buf.bump_revision();
 	buf.wait_for_repair();
+	buf.wait_for_spelling();
 
 	buf.replace(1, 2, "e");
 	buf.bump_revision();
 	buf.wait_for_repair();
+	buf.wait_for_spelling();
 	OAK_ASSERT_EQ(buf.substr(0, buf.size()), "hello world");
 
 	std::map<size_t, bool> bad = buf.misspellings(0, buf.size());
 	OAK_ASSERT_EQ(bad.size(), 0);
 }
 
+void test_spelling_word_list ()
+{
+	ng::buffer_t buf;
+	buf.set_grammar(TestGrammarItem);
+	buf.set_spelling_dictionary(ng::word_list_spelling_dictionary({ "hello", "world", "don't" }));
+	buf.set_live_spelling(true);
+	buf.insert(0, "hello wrld, don't 42 hello");
+	buf.bump_revision();
+	buf.wait_for_repair();
+	buf.wait_for_spelling();
+
+	std::map<size_t, bool> bad = buf.misspellings(0, buf.size());
+	std::map<size_t, bool> const expected = { { 6, true }, { 10, false } };
+	OAK_ASSERT(bad == expected);
+
+	buf.replace(6, 10, "world");
+	buf.bump_revision();
+	buf.wait_for_repair();
+	buf.wait_for_spelling();
+	OAK_ASSERT_EQ(buf.misspellings(0, buf.size()).size(), 0);
+}
+
 void test_scopes ()
 {
 	ng::buffer_t buf;
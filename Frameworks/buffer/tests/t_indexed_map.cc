@@ -369,3 +369,20 @@ void test_bind_left_right ()
 		}
 	}
 }
+
+void test_refresh ()
+{
+	indexed_map_t<size_t> map;
+	for(size_t i = 0; i < 100; ++i)
+		map.set(10 * i, i);
+
+	auto it = map.find(500);
+	map.replace(0, 5, 0);
+	map.remove(285);
+	map.replace(300, 300, 7);
+	map.set(499, 1000);
+
+	OAK_ASSERT_EQ(map.refresh(it)->first, 502);
+	OAK_ASSERT_EQ(map.refresh(it)->second, 50);
+	OAK_ASSERT(map.refresh(it) == map.find(502));
+}
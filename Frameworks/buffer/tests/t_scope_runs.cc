@@ -0,0 +1,75 @@
+#include <buffer/src/scope_runs.h>
+#include <oak/oak.h>
+
+static std::vector<std::pair<ssize_t, std::string>> values (ng::scope_runs_t const& runs)
+{
+	std::vector<std::pair<ssize_t, std::string>> res;
+	for(auto const& pair : runs)
+		res.emplace_back(pair.first, to_s(pair.second));
+	return res;
+}
+
+static std::map<size_t, scope::scope_t> line_scopes ()
+{
+	return { { 0, "source.c meta.function" }, { 4, "source.c meta.function entity.name" }, { 9, "source.c meta.function" } };
+}
+
+void test_scope_runs_basic ()
+{
+	ng::scope_runs_t runs;
+	runs.set(-1, "text");
+	runs.set(5, "text string");
+	runs.set(10, "text");
+
+	OAK_ASSERT_EQ(runs.lower_bound(5)->first, 5);
+	OAK_ASSERT_EQ(runs.upper_bound(5)->first, 10);
+	OAK_ASSERT(runs.find(6) == runs.end());
+	OAK_ASSERT(runs.upper_bound(10) == runs.end());
+
+	auto it = runs.upper_bound(7);
+	OAK_ASSERT_EQ(to_s((--it)->second), "text string");
+
+	runs.replace(4, 6, 0);
+	std::vector<std::pair<ssize_t, std::string>> const expected = { { -1, "text" }, { 8, "text" } };
+	OAK_ASSERT(values(runs) == expected);
+}
+
+void test_scope_runs_assign ()
+{
+	ng::scope_runs_t runs;
+	runs.set(-1, "source.c");
+	for(size_t line = 0; line < 1000; ++line)
+		runs.assign(line * 20, (line + 1) * 20, line_scopes());
+
+	OAK_ASSERT_EQ(runs.number_of_runs(), 1001);
+	OAK_ASSERT_EQ(runs.number_of_distinct_runs(), 2);
+	OAK_ASSERT_EQ(to_s(runs.lower_bound(500 * 20 + 5)->second), "source.c meta.function");
+	OAK_ASSERT_EQ(runs.lower_bound(500 * 20 + 5)->first, 500 * 20 + 9);
+
+	runs.assign(20, 40, { { 0, "source.c comment" } });
+	OAK_ASSERT_EQ(runs.number_of_distinct_runs(), 3);
+	OAK_ASSERT_EQ(runs.upper_bound(20)->first, 40);
+
+	runs.replace(10, 30, 0);
+	OAK_ASSERT_EQ(runs.lower_bound(0)->first, 0);
+	OAK_ASSERT_EQ(runs.upper_bound(9)->first, 20);
+	OAK_ASSERT_EQ(to_s(runs.upper_bound(9)->second), "source.c meta.function");
+}
+
+void test_scope_runs_remap ()
+{
+	ng::scope_runs_t runs;
+	for(size_t line = 0; line < 10; ++line)
+		runs.assign(line * 20, (line + 1) * 20, line_scopes());
+
+	// Insert two characters at the start of each line
+	runs.remap([](ssize_t key, ssize_t& newKey){
+		newKey = key + 2 * (key / 20 + 1);
+		return true;
+	});
+
+	OAK_ASSERT_EQ(runs.begin()->first, 2);
+	OAK_ASSERT_EQ(runs.find(6)->first, 6);
+	OAK_ASSERT_EQ(runs.lower_bound(20)->first, 24);
+	OAK_ASSERT_EQ(runs.number_of_distinct_runs(), 1);
+}
@@ -3,6 +3,7 @@
 #include <io/src/path.h>
 #include <text/src/format.h>
 #include <regexp/src/format_string.h>
+#include <test/benchmark.h>
 
 struct key_t
 {
@@ -121,6 +122,23 @@ void benchmark_erase_and_insert_in_5_mb ()
 	}
 }
 
+void benchmark_ng_storage_random_edits_5_mb ()
+{
+	std::string const buffer = create_buffer(5 * 1024*1024);
+	ng::detail::storage_t storage;
+	storage.insert(0, buffer.data(), buffer.size());
+
+	test::benchmark("storage.random_edits", [&](){
+		for(size_t i = 0; i < 1000; ++i)
+		{
+			size_t const pos = arc4random_uniform(storage.size() - 64);
+			storage.erase(pos, pos + 32);
+			storage.insert(arc4random_uniform(storage.size()), buffer.data() + pos, 32);
+		}
+	});
+	OAK_ASSERT_EQ(storage.size(), buffer.size());
+}
+
 void test_bracket_operator ()
 {
 	std::string const buffer = create_buffer();
@@ -6,5 +6,6 @@
 #include "wrappers.h"
 #include "locations.h"
 #include "query.h"
+#include "settings_cache.h"
 
 #endif /* end of include guard: BUNDLES_H_Q267K08K */
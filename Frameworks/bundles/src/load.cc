@@ -3,6 +3,7 @@
 #include <regexp/src/glob.h>
 #include <text/src/format.h>
 #include <oak/debug.h>
+#include <oak/trace.h>
 
 static std::string const kSeparatorString = "------------------------------------";
 
@@ -33,6 +34,8 @@ static void remove_cycles (oak::uuid_t const& menuUUID, std::map< oak::uuid_t, s
 
 std::pair<std::vector<bundles::item_ptr>, std::map< oak::uuid_t, std::vector<oak::uuid_t>>> create_bundle_index (std::vector<std::string> const& bundlesPaths, plist::cache_t& cache)
 {
+	oak::trace::span_t span("bundles", "create_bundle_index");
+
 	struct delta_item_t
 	{
 		delta_item_t (bundles::item_ptr item, plist::dictionary_t const& plist) : item(item), plist(plist) { }
@@ -0,0 +1,71 @@
+#ifndef BUNDLES_SETTINGS_CACHE_H_R4M8XW2N
+#define BUNDLES_SETTINGS_CACHE_H_R4M8XW2N
+
+#include "query.h"
+
+namespace bundles
+{
+	// Remembers a value derived from bundle settings per key (usually a
+	// scope) and forgets everything when bundles change. Values are computed
+	// without holding the lock, and one computed while bundles changed is
+	// returned but not kept. Instances are meant to be leaked singletons.
+
+	template <typename Key, typename Value>
+	struct settings_cache_t : callback_t
+	{
+		settings_cache_t (std::function<Value(Key const&)> const& compute, size_t maxKeys = 1024) : _compute(compute), _max_keys(maxKeys)
+		{
+			add_callback(this);
+		}
+
+		~settings_cache_t ()
+		{
+			remove_callback(this);
+		}
+
+		Value lookup (Key const& key)
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+
+			auto it = _values.find(key);
+			if(it != _values.end())
+				return it->second;
+			size_t const generation = _generation;
+			lock.unlock();
+
+			Value value = _compute(key);
+
+			lock.lock();
+			if(generation != _generation)
+				return value;
+			if(_values.size() >= _max_keys)
+				_values.clear();
+			return _values.emplace(key, value).first->second;
+		}
+
+		// Incremented when bundles change, i.e. when values derived from earlier lookups may be outdated
+		size_t generation ()
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			return _generation;
+		}
+
+		void bundles_did_change ()
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_values.clear();
+			++_generation;
+		}
+
+	private:
+		std::function<Value(Key const&)> _compute;
+		size_t _max_keys;
+
+		std::mutex _mutex;
+		std::map<Key, Value> _values;
+		size_t _generation = 1;
+	};
+
+} /* bundles */
+
+#endif /* end of include guard: BUNDLES_SETTINGS_CACHE_H_R4M8XW2N */
@@ -1,5 +1,6 @@
 #include "wrappers.h"
 #include "query.h"
+#include "settings_cache.h"
 #include <text/src/case.h>
 #include <io/src/path.h>
 #include <regexp/src/regexp.h>
@@ -145,37 +146,84 @@ namespace bundles
 		return res;
 	}
 
-	std::map<std::string, std::string> scope_variables (std::map<std::string, std::string> const& base, scope::context_t const& scope)
+	namespace
 	{
-		std::map<std::string, std::string> res = base;
-		std::vector<item_ptr> const& items = query(kFieldSettingName, "shellVariables", scope, kItemTypeSettings, oak::uuid_t(), false);
-
-		std::vector< std::set<std::string> > stack;
-		riterate(item, items)
+		// The shellVariables settings matching a scope in the order they are applied, with values parsed and bundle variables resolved
+		struct shell_variables_layer_t
 		{
-			stack.push_back(std::set<std::string>());
-			for(auto pair : shell_variables(*item))
+			shell_variables_layer_t (scope::context_t const& scope)
 			{
-				auto tmp = (*item)->bundle_variables();
-				res[pair.first] = format_string::expand(pair.second, tmp << res);
-				stack.back().insert(pair.first);
+				std::vector<item_ptr> const& items = query(kFieldSettingName, "shellVariables", scope, kItemTypeSettings, oak::uuid_t(), false);
+
+				std::vector< std::set<std::string> > stack;
+				riterate(item, items)
+				{
+					stack.push_back(std::set<std::string>());
+					settings.emplace_back();
+					settings.back().bundle_variables = (*item)->bundle_variables();
+					for(auto pair : shell_variables(*item))
+					{
+						settings.back().variables.emplace_back(pair.first, format_string::format_string_t(pair.second));
+						stack.back().insert(pair.first);
+					}
+				}
+
+				std::set<std::string> didSet, shouldUnset;
+				riterate(set, stack)
+				{
+					std::vector<std::string> tmp;
+					std::set_intersection(set->begin(), set->end(), didSet.begin(), didSet.end(), back_inserter(tmp));
+
+					if(tmp.empty())
+							didSet.insert(set->begin(), set->end());
+					else	shouldUnset.insert(set->begin(), set->end());
+				}
+
+				std::set_difference(shouldUnset.begin(), shouldUnset.end(), didSet.begin(), didSet.end(), back_inserter(unset));
 			}
-		}
 
-		std::set<std::string> didSet, shouldUnset;
-		riterate(set, stack)
+			struct settings_t
+			{
+				std::map<std::string, std::string> bundle_variables;
+				std::vector< std::pair<std::string, format_string::format_string_t> > variables;
+			};
+
+			std::vector<settings_t> settings;
+			std::vector<std::string> unset;
+		};
+
+		typedef std::shared_ptr<shell_variables_layer_t const> shell_variables_layer_ptr;
+
+		static settings_cache_t<scope::context_t, shell_variables_layer_ptr>& shell_variables_cache ()
 		{
-			std::vector<std::string> tmp;
-			std::set_intersection(set->begin(), set->end(), didSet.begin(), didSet.end(), back_inserter(tmp));
+			static auto* cache = new settings_cache_t<scope::context_t, shell_variables_layer_ptr>([](scope::context_t const& scope){
+				return std::make_shared<shell_variables_layer_t const>(scope);
+			});
+			return *cache;
+		}
+	}
+
+	std::map<std::string, std::string> scope_variables (std::map<std::string, std::string> const& base, scope::context_t const& scope)
+	{
+		std::map<std::string, std::string> res = base;
 
-			if(tmp.empty())
-					didSet.insert(set->begin(), set->end());
-			else	shouldUnset.insert(set->begin(), set->end());
+		shell_variables_layer_ptr layer = shell_variables_cache().lookup(scope);
+		for(auto const& settings : layer->settings)
+		{
+			// The item’s bundle variables take precedence over those already set
+			auto getVariable = [&](std::string const& name) -> std::optional<std::string> {
+				auto it = settings.bundle_variables.find(name);
+				if(it != settings.bundle_variables.end())
+					return it->second;
+				it = res.find(name);
+				return it != res.end() ? it->second : std::optional<std::string>();
+			};
+
+			for(auto const& pair : settings.variables)
+				res[pair.first] = pair.second.expand(getVariable);
 		}
 
-		std::vector<std::string> tmp;
-		std::set_difference(shouldUnset.begin(), shouldUnset.end(), didSet.begin(), didSet.end(), back_inserter(tmp));
-		for(auto const& key : tmp)
+		for(auto const& key : layer->unset)
 			res.erase(key);
 
 		return res;
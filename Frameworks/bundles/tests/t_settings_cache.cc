@@ -0,0 +1,42 @@
+#include <bundles/src/settings_cache.h>
+
+void test_settings_cache ()
+{
+	size_t computed = 0;
+	bundles::settings_cache_t<std::string, size_t> cache([&](std::string const& key){ ++computed; return key.size(); }, 2);
+
+	OAK_ASSERT_EQ(cache.lookup("foo"), 3);
+	OAK_ASSERT_EQ(cache.lookup("foo"), 3);
+	OAK_ASSERT_EQ(computed, 1);
+
+	size_t const generation = cache.generation();
+	cache.bundles_did_change();
+	OAK_ASSERT_EQ(cache.generation(), generation + 1);
+	OAK_ASSERT_EQ(cache.lookup("foo"), 3);
+	OAK_ASSERT_EQ(computed, 2);
+
+	// Exceeding the limit starts over
+	cache.lookup("bar");
+	cache.lookup("fud");
+	OAK_ASSERT_EQ(computed, 4);
+	cache.lookup("foo");
+	OAK_ASSERT_EQ(computed, 5);
+}
+
+void test_settings_cache_outdated_value ()
+{
+	size_t computed = 0;
+	bundles::settings_cache_t<std::string, size_t>* cache = nullptr;
+	bundles::settings_cache_t<std::string, size_t> tmp([&](std::string const& key){
+		if(++computed == 1)
+			cache->bundles_did_change(); // bundles change while we compute
+		return key.size();
+	});
+	cache = &tmp;
+
+	OAK_ASSERT_EQ(cache->lookup("foo"), 3);
+	OAK_ASSERT_EQ(cache->lookup("foo"), 3);
+	OAK_ASSERT_EQ(computed, 2);
+	OAK_ASSERT_EQ(cache->lookup("foo"), 3);
+	OAK_ASSERT_EQ(computed, 2);
+}
@@ -13,6 +13,9 @@ namespace command
 	void fix_shebang (std::string* command);
 	std::string create_script_path (std::string const& command);
 
+	// Launches ‘path’ in its own process group with ‘inputFd’ as stdin. Returns the process id (-1 on failure) and the read ends of its stdout and stderr, on failure the reason is written to the latter. A missing ‘workingDir’ is replaced by the temporary folder
+	std::tuple<pid_t, int, int> spawn_script (std::string const& path, int inputFd, std::map<std::string, std::string> const& environment, std::string const& workingDir);
+
 	struct delegate_t;
 	struct runner_t;
 
@@ -5,6 +5,7 @@
 #include <io/src/path.h>
 #include <io/src/pipe.h>
 #include <regexp/src/format_string.h>
+#include <text/src/format.h>
 #include <oak/datatypes.h>
 
 static std::string trim_right (std::string const& str, std::string const& trimChars = " \t\n")
@@ -13,72 +14,6 @@ static std::string trim_right (std::string const& str, std::string const& trimCh
 	return len == std::string::npos ? "" : str.substr(0, len+1);
 }
 
-static std::tuple<pid_t, int, int> my_fork (char const* cmd, int inputRead, std::map<std::string, std::string> const& environment, char const* workingDir)
-{
-	for(auto const& pair : environment)
-	{
-		if(pair.first.size() + pair.second.size() + 2 < ARG_MAX)
-			continue;
-
-		std::map<std::string, std::string> newEnv;
-		for(auto const& pair : environment)
-		{
-			if(pair.first.size() + pair.second.size() + 2 < ARG_MAX)
-			{
-				newEnv.insert(pair);
-			}
-			else
-			{
-				newEnv.emplace(pair.first, "(truncated)");
-				os_log_error(OS_LOG_DEFAULT, "Variable exceeds ARG_MAX: %{public}s", pair.first.c_str());
-			}
-		}
-		return my_fork(cmd, inputRead, newEnv, workingDir);
-	}
-
-	int outputRead, outputWrite, errorRead, errorWrite;
-	std::tie(outputRead, outputWrite) = io::create_pipe();
-	std::tie(errorRead,  errorWrite)  = io::create_pipe();
-
-	oak::c_array env(environment);
-
-	pid_t pid = vfork();
-	if(pid == 0)
-	{
-		int const signals[] = { SIGINT, SIGTERM, SIGPIPE, SIGUSR1 };
-		for(int sig : signals) signal(sig, SIG_DFL);
-
-		int const oldOutErr[] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
-		int const newOutErr[] = { inputRead, outputWrite, errorWrite };
-
-		for(int fd = getdtablesize(); --fd > STDERR_FILENO; )
-		{
-			int flags = fcntl(fd, F_GETFD);
-			if((flags == -1 && errno == EBADF) || (flags & FD_CLOEXEC) == FD_CLOEXEC)
-				continue;
-
-			if(close(fd) == -1)
-				perror("runner_t: close");
-		}
-
-		for(int fd : oldOutErr) close(fd);
-		for(int fd : newOutErr) dup(fd);
-
-		setpgid(0, getpid());
-		chdir(workingDir);
-
-		char* argv[] = { (char*)cmd, NULL };
-		execve(argv[0], argv, env);
-		perror("runner_t: execve");
-		_exit(EXIT_FAILURE);
-	}
-
-	int const fds[] = { inputRead, outputWrite, errorWrite };
-	for(int fd : fds) close(fd);
-
-	return { pid, outputRead, errorRead };
-}
-
 static void exhaust_fd_in_queue (dispatch_group_t group, int fd, CFRunLoopRef runLoop, void(^handler)(char const* bytes, size_t len))
 {
 	dispatch_group_async(group, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
@@ -105,7 +40,8 @@ static pid_t run_command (dispatch_group_t rootGroup, std::string const& cmd, in
 {
 	pid_t pid;
 	int outputFd, errorFd;
-	std::tie(pid, outputFd, errorFd) = my_fork(cmd.c_str(), inputFd, env, cwd.c_str());
+	std::tie(pid, outputFd, errorFd) = command::spawn_script(cmd, inputFd, env, cwd);
+	close(inputFd);
 
 	dispatch_group_t group = dispatch_group_create();
 	exhaust_fd_in_queue(group, outputFd, runLoop, stdoutHandler);
@@ -113,7 +49,9 @@ static pid_t run_command (dispatch_group_t rootGroup, std::string const& cmd, in
 
 	__block int status = 0;
 	dispatch_group_async(group, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
-		if(waitpid(pid, &status, 0) != pid)
+		if(pid == -1)
+			status = W_EXITCODE(EXIT_FAILURE, 0);
+		else if(waitpid(pid, &status, 0) != pid)
 			perror("runner_t: waitpid");
 	});
 
@@ -148,11 +86,21 @@ namespace command
 		return output;
 	}
 
+	// Scripts are named after their SHA-1 so we only need to write each one once. Once written we remember the path and only check that it still exists, as the caches folder can be cleaned while we run.
 	std::string create_script_path (std::string const& command)
 	{
+		static std::mutex* mutex = new std::mutex;
+		static std::map<std::string, std::string>* scriptPaths = new std::map<std::string, std::string>;
+
 		NSData* data = [NSData dataWithBytesNoCopy:(void*)command.data() length:command.size() freeWhenDone:NO];
+		NSString* digest = hash(data);
+
+		std::lock_guard<std::mutex> lock(*mutex);
+		auto it = scriptPaths->find(digest.UTF8String);
+		if(it != scriptPaths->end() && access(it->second.c_str(), X_OK) == 0)
+			return it->second;
 
-		NSString* scriptPath = [NSString pathWithComponents:@[ NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES).firstObject, NSBundle.mainBundle.bundleIdentifier, @"Scripts", hash(data) ]];
+		NSString* scriptPath = [NSString pathWithComponents:@[ NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES).firstObject, NSBundle.mainBundle.bundleIdentifier, @"Scripts", digest ]];
 		if(![NSFileManager.defaultManager isExecutableFileAtPath:scriptPath])
 		{
 			[NSFileManager.defaultManager createDirectoryAtPath:scriptPath.stringByDeletingLastPathComponent withIntermediateDirectories:YES attributes:nil error:nullptr];
@@ -161,7 +109,105 @@ namespace command
 			[NSFileManager.defaultManager setAttributes:@{ NSFilePosixPermissions: @(S_IRWXU) } ofItemAtPath:scriptPath error:nil];
 		}
 
-		return scriptPath.fileSystemRepresentation;
+		std::string res = scriptPath.fileSystemRepresentation;
+		if(access(res.c_str(), X_OK) == 0)
+			scriptPaths->insert_or_assign(digest.UTF8String, res);
+		return res;
+	}
+
+	// The attributes are the same for all commands so they are only set up once
+	static posix_spawnattr_t const* spawn_attributes ()
+	{
+		static posix_spawnattr_t* const res = []() -> posix_spawnattr_t* {
+			posix_spawnattr_t* attr = new posix_spawnattr_t;
+			if(posix_spawnattr_init(attr) != 0)
+			{
+				perror("posix_spawnattr_init");
+				return nullptr;
+			}
+
+			sigset_t signals;
+			sigemptyset(&signals);
+			for(int sig : { SIGINT, SIGTERM, SIGPIPE, SIGUSR1 })
+				sigaddset(&signals, sig);
+
+			// With POSIX_SPAWN_CLOEXEC_DEFAULT the child only inherits the descriptors set up by our file actions
+			if(posix_spawnattr_setsigdefault(attr, &signals) != 0 || posix_spawnattr_setpgroup(attr, 0) != 0 || posix_spawnattr_setflags(attr, POSIX_SPAWN_SETSIGDEF|POSIX_SPAWN_SETPGROUP|POSIX_SPAWN_CLOEXEC_DEFAULT) != 0)
+			{
+				perror("posix_spawnattr_setflags");
+				posix_spawnattr_destroy(attr);
+				return nullptr;
+			}
+			return attr;
+		}();
+		return res;
+	}
+
+	std::tuple<pid_t, int, int> spawn_script (std::string const& path, int inputFd, std::map<std::string, std::string> const& environment, std::string const& workingDir)
+	{
+		for(auto const& pair : environment)
+		{
+			if(pair.first.size() + pair.second.size() + 2 < ARG_MAX)
+				continue;
+
+			std::map<std::string, std::string> newEnv;
+			for(auto const& pair : environment)
+			{
+				if(pair.first.size() + pair.second.size() + 2 < ARG_MAX)
+				{
+					newEnv.insert(pair);
+				}
+				else
+				{
+					newEnv.emplace(pair.first, "(truncated)");
+					os_log_error(OS_LOG_DEFAULT, "Variable exceeds ARG_MAX: %{public}s", pair.first.c_str());
+				}
+			}
+			return spawn_script(path, inputFd, newEnv, workingDir);
+		}
+
+		int outputRead, outputWrite, errorRead, errorWrite;
+		std::tie(outputRead, outputWrite) = io::create_pipe();
+		std::tie(errorRead,  errorWrite)  = io::create_pipe();
+
+		// The chdir file action makes posix_spawn fail for a missing directory so we use the temporary folder instead
+		std::string const directory = path::is_directory(workingDir) ? workingDir : path::temp();
+
+		pid_t pid = -1;
+		int error = 0;
+		posix_spawn_file_actions_t fileActions;
+		if((error = posix_spawn_file_actions_init(&fileActions)) == 0)
+		{
+			char* argv[] = { (char*)path.c_str(), nullptr };
+			if((error = posix_spawn_file_actions_addchdir_np(&fileActions, directory.c_str())) == 0 && (error = posix_spawn_file_actions_adddup2(&fileActions, inputFd, STDIN_FILENO)) == 0 && (error = posix_spawn_file_actions_adddup2(&fileActions, outputWrite, STDOUT_FILENO)) == 0 && (error = posix_spawn_file_actions_adddup2(&fileActions, errorWrite, STDERR_FILENO)) == 0)
+			{
+				if(posix_spawnattr_t const* attr = spawn_attributes())
+				{
+					if((error = posix_spawn(&pid, argv[0], &fileActions, attr, argv, oak::c_array(environment))) != 0)
+						pid = -1;
+				}
+				else
+				{
+					error = EINVAL;
+				}
+			}
+			posix_spawn_file_actions_destroy(&fileActions);
+		}
+
+		if(pid == -1)
+		{
+			os_log_error(OS_LOG_DEFAULT, "posix_spawn(\"%{public}s\"): %{errno}d", path.c_str(), error);
+
+			// Let the caller’s stderr handler show why the command did not run
+			std::string const message = text::format("Failed to run command: %s\n", strerror(error));
+			if(write(errorWrite, message.data(), message.size()) == -1)
+				perror("spawn_script: write");
+		}
+
+		int const fds[] = { outputWrite, errorWrite };
+		for(int fd : fds) close(fd);
+
+		return { pid, outputRead, errorRead };
 	}
 
 	// ==================
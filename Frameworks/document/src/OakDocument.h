@@ -7,6 +7,7 @@
 
 extern NSNotificationName const OakDocumentContentDidChangeNotification;
 extern NSNotificationName const OakDocumentMarksDidChangeNotification;
+extern NSNotificationName const OakDocumentSymbolsDidChangeNotification;
 extern NSNotificationName const OakDocumentWillReloadNotification;
 extern NSNotificationName const OakDocumentDidReloadNotification;
 extern NSNotificationName const OakDocumentWillSaveNotification;
@@ -163,6 +163,7 @@ namespace document
 
 NSNotificationName const OakDocumentContentDidChangeNotification = @"OakDocumentContentDidChangeNotification";
 NSNotificationName const OakDocumentMarksDidChangeNotification   = @"OakDocumentMarksDidChangeNotification";
+NSNotificationName const OakDocumentSymbolsDidChangeNotification = @"OakDocumentSymbolsDidChangeNotification";
 NSNotificationName const OakDocumentWillReloadNotification       = @"OakDocumentWillReloadNotification";
 NSNotificationName const OakDocumentDidReloadNotification        = @"OakDocumentDidReloadNotification";
 NSNotificationName const OakDocumentWillSaveNotification         = @"OakDocumentWillSaveNotification";
@@ -686,6 +687,80 @@ static void* kDocumentEditedObserverContext = &kDocumentEditedObserverContext;
 	return NO;
 }
 
+// ================
+// = Undo History =
+// ================
+
+static NSString* UndoHistoryDirectory ()
+{
+	return [[NSSearchPathForDirectoriesInDomains(NSApplicationSupportDirectory, NSUserDomainMask, YES) firstObject] stringByAppendingPathComponent:@"TextMate/UndoHistory"];
+}
+
+// A history is only restored while its document is unchanged, so old ones are unlikely to be used again
+static void PruneUndoHistory (NSString* directory)
+{
+	static NSUInteger const kMaxHistories = 500;
+	static NSTimeInterval const kMaxHistoryAge = 30*24*60*60;
+
+	NSArray<NSURL*>* urls = [NSFileManager.defaultManager contentsOfDirectoryAtURL:[NSURL fileURLWithPath:directory isDirectory:YES] includingPropertiesForKeys:@[ NSURLContentModificationDateKey ] options:0 error:nil];
+
+	NSMutableArray<NSURL*>* sorted = [NSMutableArray array];
+	NSMutableDictionary<NSURL*, NSDate*>* dates = [NSMutableDictionary dictionary];
+	for(NSURL* url in urls)
+	{
+		NSDate* date;
+		if([url getResourceValue:&date forKey:NSURLContentModificationDateKey error:nil] && date)
+		{
+			dates[url] = date;
+			[sorted addObject:url];
+		}
+	}
+
+	[sorted sortUsingComparator:^NSComparisonResult(NSURL* lhs, NSURL* rhs){
+		return [dates[rhs] compare:dates[lhs]];
+	}];
+
+	NSDate* cutOff = [NSDate dateWithTimeIntervalSinceNow:-kMaxHistoryAge];
+	for(NSUInteger i = 0; i < sorted.count; ++i)
+	{
+		if(i >= kMaxHistories || [dates[sorted[i]] compare:cutOff] == NSOrderedAscending)
+			[NSFileManager.defaultManager removeItemAtURL:sorted[i] error:nil];
+	}
+}
+
+- (NSString*)undoHistoryPath
+{
+	char const* path = [_path fileSystemRepresentation];
+	uint8_t digest[CC_SHA256_DIGEST_LENGTH];
+	CC_SHA256(path, strlen(path), digest);
+
+	NSMutableString* name = [NSMutableString stringWithCapacity:CC_SHA256_DIGEST_LENGTH * 2];
+	for(size_t i = 0; i < CC_SHA256_DIGEST_LENGTH; ++i)
+		[name appendFormat:@"%02x", digest[i]];
+	return [UndoHistoryDirectory() stringByAppendingPathComponent:name];
+}
+
+- (void)saveUndoHistory
+{
+	NSString* path = [self undoHistoryPath];
+	if(_undoManager && (_undoManager->can_undo() || _undoManager->can_redo()))
+	{
+		if([NSFileManager.defaultManager createDirectoryAtPath:[path stringByDeletingLastPathComponent] withIntermediateDirectories:YES attributes:nil error:nullptr])
+			_undoManager->save(to_s(path), to_s(_path));
+	}
+	else
+	{
+		unlink([path fileSystemRepresentation]);
+	}
+
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0), ^{
+			PruneUndoHistory(UndoHistoryDirectory());
+		});
+	});
+}
+
 // =================
 // = Load Document =
 // =================
@@ -889,6 +964,9 @@ static void* kDocumentEditedObserverContext = &kDocumentEditedObserverContext;
 	_buffer->set_async_parsing(true);
 	_buffer->bump_revision();
 
+	if(_path)
+		_undoManager->load(to_s([self undoHistoryPath]), to_s(_path));
+
 	self.onDisk         = _path && access([_path fileSystemRepresentation], F_OK) == 0;
 	self.savedRevision  = _buffer->revision();
 	self.backupRevision = _buffer->revision(); // This is ignored when backupPath is nil
@@ -1094,6 +1172,7 @@ static void* kDocumentEditedObserverContext = &kDocumentEditedObserverContext;
 			settings_t const settings = settings_for_path(to_s(_path), to_s(_fileType), to_s([_path stringByDeletingLastPathComponent] ?: _directory));
 			if(!settings.get(kSettingsDisableExtendedAttributesKey, false))
 				path::set_attributes(to_s(_path), [self extendedAttributeds]);
+			[self saveUndoHistory];
 		}
 	}
 
@@ -1119,15 +1198,46 @@ static void* kDocumentEditedObserverContext = &kDocumentEditedObserverContext;
 		callback_t (OakDocument* self) : _self(self) { }
 
 		void will_replace (size_t from, size_t to, char const* buf, size_t len)
+		{
+			will_change(from);
+		}
+
+		void did_replace (size_t from, size_t to, char const* buf, size_t len)
+		{
+			did_change(len - (to - from));
+		}
+
+		// Replacements are sorted so the first one decides whether the first line is affected
+		void will_replace_batch (std::vector<ng::replacement_t> const& replacements)
+		{
+			will_change(replacements.front().from);
+		}
+
+		void did_replace_batch (std::vector<ng::replacement_t> const& replacements)
+		{
+			ssize_t delta = 0;
+			for(auto const& r : replacements)
+				delta += r.str.size() - (r.to - r.from);
+			did_change(delta);
+		}
+
+		// Symbols expanded in the background arrive after the parse callback
+		void did_update_symbols ()
+		{
+			[NSNotificationCenter.defaultCenter postNotificationName:OakDocumentSymbolsDidChangeNotification object:_self];
+		}
+
+	private:
+		void will_change (size_t from)
 		{
 			ng::buffer_t const& buffer = [_self buffer];
 			_should_sniff_file_type = from == std::clamp(from, buffer.begin(0), buffer.eol(0)) && _self.shouldSniffFileType;
 			_file_type = _should_sniff_file_type ? file_type(buffer) : NULL_STR;
 		}
 
-		void did_replace (size_t from, size_t to, char const* buf, size_t len)
+		void did_change (ssize_t delta)
 		{
-			_size += len - (to - from);
+			_size += delta;
 			if(_self.bufferEmpty != (_size == 0))
 				_self.bufferEmpty = _size == 0;
 
@@ -1141,7 +1251,6 @@ static void* kDocumentEditedObserverContext = &kDocumentEditedObserverContext;
 			[_self bufferDidChange];
 		}
 
-	private:
 		static std::string file_type (ng::buffer_t const& buffer)
 		{
 			return file::type_from_bytes(std::make_shared<io::bytes_t>(buffer.substr(buffer.begin(0), std::min<size_t>(buffer.eol(0), 2048))));
@@ -78,6 +78,11 @@ static int32_t const NSWrapColumnWindowWidth = 0;
 				[_self didChangeBuffer];
 			}
 
+			void did_replace_batch (std::vector<ng::replacement_t> const& replacements)
+			{
+				[_self didChangeBuffer];
+			}
+
 		private:
 			__weak OakDocumentEditor* _self;
 		};
@@ -1,42 +1,103 @@
 #include "merge.h"
-#include <io/src/io.h>
+#include <text/src/diff.h>
 
-std::string merge (std::string const& oldContent, std::string const& myContent, std::string const& yourContent, bool* conflict)
+// Like diff3(1) we compare each side against the old file in that
+// direction and not the reverse, as the alignment of ambiguous changes
+// depends on the order.
+static std::vector<text::diff_hunk_t> changes_from_old (std::vector<std::string_view> const& oldLines, std::vector<std::string_view> const& newLines)
 {
-	std::string oldFile  = path::temp("merge", oldContent);
-	std::string myFile   = path::temp("merge", myContent);
-	std::string yourFile = path::temp("merge", yourContent);
+	auto res = text::diff_lines(newLines, oldLines);
+	for(auto& hunk : res)
+	{
+		std::swap(hunk.first_from, hunk.second_from);
+		std::swap(hunk.first_to, hunk.second_to);
+	}
+	return res;
+}
+
+static void append (std::string& dst, std::vector<std::string_view> const& lines, size_t from, size_t to)
+{
+	for(size_t i = from; i < to; ++i)
+		dst.append(lines[i].data(), lines[i].size());
+}
+
+std::string merge (std::string_view oldContent, std::string_view myContent, std::string_view yourContent, bool* conflict)
+{
+	auto const oldLines   = text::split_lines(oldContent);
+	auto const myLines    = text::split_lines(myContent);
+	auto const yourLines  = text::split_lines(yourContent);
+	auto const myHunks    = changes_from_old(oldLines, myLines);
+	auto const yourHunks  = changes_from_old(oldLines, yourLines);
 
-	ASSERT(oldFile != NULL_STR && myFile != NULL_STR && yourFile != NULL_STR);
+	std::string res;
+	res.reserve(std::max(myContent.size(), yourContent.size()));
 
-	__block int status = 0;
-	__block std::string output, error;
+	bool foundConflict = false;
+	size_t copied = 0; // lines of ‘myLines’ already handled
+	ssize_t myDelta = 0, yourDelta = 0;
 
-	if(io::process_t process = io::spawn(std::vector<std::string>{ "/usr/bin/diff3", "-Em", "-LLocal Changes", "-LOld File", "-LExternal Changes", myFile, oldFile, yourFile }, oak::basic_environment()))
+	for(size_t i = 0, j = 0; i < myHunks.size() || j < yourHunks.size(); )
 	{
-		close(process.in);
-
-		dispatch_group_t group = dispatch_group_create();
-		dispatch_group_async(group, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
-			io::exhaust_fd(process.out, &output);
-		});
-		dispatch_group_async(group, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
-			io::exhaust_fd(process.err, &error);
-		});
-		dispatch_group_async(group, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
-			if(waitpid(process.pid, &status, 0) != process.pid)
-				perror("merge: waitpid");
-		});
-		dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
-		dispatch_release(group);
-
-		if(conflict)
-			*conflict = WIFEXITED(status) && WEXITSTATUS(status) != 0;
-	}
+		// Group hunks from both sides that overlap or touch in the old file,
+		// starting with the one that begins first (ours on a tie).
+		size_t const firstMine = i, firstYours = j;
+		bool const mineFirst = j == yourHunks.size() || (i < myHunks.size() && myHunks[i].first_from <= yourHunks[j].first_from);
+		size_t const oldFrom = mineFirst ? myHunks[i].first_from : yourHunks[j].first_from;
+		size_t oldTo = mineFirst ? myHunks[i++].first_to : yourHunks[j++].first_to;
+
+		while(true)
+		{
+			if(i < myHunks.size() && myHunks[i].first_from <= oldTo)
+				oldTo = std::max(oldTo, myHunks[i++].first_to);
+			else if(j < yourHunks.size() && yourHunks[j].first_from <= oldTo)
+				oldTo = std::max(oldTo, yourHunks[j++].first_to);
+			else
+				break;
+		}
+
+		size_t myFrom = oldFrom + myDelta, myTo = oldTo + myDelta;
+		if(firstMine != i)
+		{
+			myFrom = oldFrom - myHunks[firstMine].first_from + myHunks[firstMine].second_from;
+			myTo   = oldTo - myHunks[i-1].first_to + myHunks[i-1].second_to;
+		}
+
+		size_t yourFrom = oldFrom + yourDelta, yourTo = oldTo + yourDelta;
+		if(firstYours != j)
+		{
+			yourFrom = oldFrom - yourHunks[firstYours].first_from + yourHunks[firstYours].second_from;
+			yourTo   = oldTo - yourHunks[j-1].first_to + yourHunks[j-1].second_to;
+		}
 
-	unlink(oldFile.c_str());
-	unlink(myFile.c_str());
-	unlink(yourFile.c_str());
+		myDelta   = myTo - oldTo;
+		yourDelta = yourTo - oldTo;
+
+		if(firstYours == j) // only changed by us
+			continue;
+
+		bool const bothChanged = firstMine != i;
+		if(bothChanged && std::equal(myLines.begin() + myFrom, myLines.begin() + myTo, yourLines.begin() + yourFrom, yourLines.begin() + yourTo))
+			continue;
+
+		append(res, myLines, copied, myFrom);
+		if(bothChanged)
+		{
+			foundConflict = true;
+			res += "<<<<<<< Local Changes\n";
+			append(res, myLines, myFrom, myTo);
+			res += "=======\n";
+			append(res, yourLines, yourFrom, yourTo);
+			res += ">>>>>>> External Changes\n";
+		}
+		else
+		{
+			append(res, yourLines, yourFrom, yourTo);
+		}
+		copied = myTo;
+	}
+	append(res, myLines, copied, myLines.size());
 
-	return WIFEXITED(status) ? output : NULL_STR;
+	if(conflict)
+		*conflict = foundConflict;
+	return res;
 }
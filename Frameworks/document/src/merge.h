@@ -1,6 +1,11 @@
 #ifndef MERGE_H_G9U6AOAI
 #define MERGE_H_G9U6AOAI
 
-std::string merge (std::string const& oldContent, std::string const& myContent, std::string const& yourContent, bool* conflict = NULL);
+#include <string_view>
+
+// Three-way merge with the output of ‘diff3 -Em’: changes made only in
+// ‘yourContent’ are applied to ‘myContent’ and overlapping changes are
+// bracketed with conflict markers.
+std::string merge (std::string_view oldContent, std::string_view myContent, std::string_view yourContent, bool* conflict = NULL);
 
 #endif /* end of include guard: MERGE_H_G9U6AOAI */
@@ -0,0 +1,22 @@
+#include <document/src/merge.h>
+
+void test_merge_without_conflict ()
+{
+	bool conflict = true;
+	OAK_ASSERT_EQ(merge("1\n2\n3\n4\n5\n", "1\nA\n3\n4\n5\n", "1\n2\n3\n4\nB\n", &conflict), "1\nA\n3\n4\nB\n");
+	OAK_ASSERT_EQ(conflict, false);
+
+	OAK_ASSERT_EQ(merge("1\n2\n3\n", "1\nA\n3\n", "1\nA\n3\n", &conflict), "1\nA\n3\n");
+	OAK_ASSERT_EQ(conflict, false);
+}
+
+void test_merge_with_conflict ()
+{
+	bool conflict = false;
+	OAK_ASSERT_EQ(merge("1\n2\n3\n4\n5\n", "1\nA\n3\n4\n5\n", "1\nX\n3\n4\n5\n", &conflict), "1\n<<<<<<< Local Changes\nA\n=======\nX\n>>>>>>> External Changes\n3\n4\n5\n");
+	OAK_ASSERT_EQ(conflict, true);
+
+	// changes to adjacent lines conflict, as with diff3(1)
+	OAK_ASSERT_EQ(merge("1\n2\n3\n", "A\n2\n3\n", "1\nB\n3\n", &conflict), "<<<<<<< Local Changes\nA\n2\n=======\n1\nB\n>>>>>>> External Changes\n3\n");
+	OAK_ASSERT_EQ(conflict, true);
+}
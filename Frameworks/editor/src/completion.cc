@@ -9,14 +9,13 @@
 #include <settings/src/settings.h>
 
 template <typename _OutputIter>
-_OutputIter words_with_prefix_and_suffix (ng::buffer_t const& buffer, std::string const& prefix, std::string const& suffix, std::string const& excludeWord, _OutputIter out)
+_OutputIter words_with_prefix_and_suffix (ng::buffer_t const& buffer, size_t bow, std::string const& prefix, std::string const& suffix, std::string const& excludeWord, _OutputIter out)
 {
-	for(auto const& pair : ng::find_all(buffer, prefix.size() < suffix.size() ? suffix : prefix, find::none))
+	for(auto const& pair : buffer.words(prefix, bow))
 	{
-		ng::range_t range = ng::extend(buffer, pair.first, kSelectionExtendToWord).last();
-		size_t bow = range.min().index, eow = range.max().index;
-		if(prefix.size() < (eow - bow) && prefix == buffer.substr(bow, bow + prefix.size()) && suffix.size() < (eow - bow) && suffix == buffer.substr(eow - suffix.size(), eow) && excludeWord != buffer.substr(bow, eow))
-			*out++ = std::make_pair(bow, buffer.substr(bow, eow));
+		std::string const& word = pair.first;
+		if(prefix.size() < word.size() && suffix.size() < word.size() && word.compare(word.size() - suffix.size(), suffix.size(), suffix) == 0 && excludeWord != word)
+			*out++ = std::make_pair(pair.second, word);
 	}
 	return out;
 }
@@ -127,9 +126,9 @@ namespace ng
 		if(!plist::is_true(bundles::value_for_setting("disableDefaultCompletion", scope, &item)))
 		{
 			size_t cnt = tmp.size();
-			words_with_prefix_and_suffix(_buffer, prefix, suffix, currentWord, back_inserter(tmp));
+			words_with_prefix_and_suffix(_buffer, bow, prefix, suffix, currentWord, back_inserter(tmp));
 			if(cnt == tmp.size())
-				words_with_prefix_and_suffix(_buffer, prefix, "", currentWord, back_inserter(tmp));
+				words_with_prefix_and_suffix(_buffer, bow, prefix, "", currentWord, back_inserter(tmp));
 		}
 
 		// ===============================================
@@ -206,8 +206,64 @@ namespace ng
 		return replacements;
 	}
 
+	static bool is_non_overlapping (std::multimap<range_t, std::string> const& replacements)
+	{
+		size_t end = 0;
+		for(auto const& pair : replacements)
+		{
+			range_t const range = pair.first.sorted();
+			if(range.first.index < end)
+				return false;
+			end = range.last.index;
+		}
+		return true;
+	}
+
+	// Without an active snippet each replacement maps to exactly one buffer edit, so for non-overlapping ranges (the multiple carets case) we can apply them all as one bulk replace: a single pass over the buffer, one batch of callbacks, and one undo record
+	static ranges_t bulk_replace_helper (ng::buffer_t& buffer, std::multimap<range_t, std::string> const& replacements)
+	{
+		std::vector<ng::replacement_t> edits;
+		edits.reserve(replacements.size());
+		for(auto const& pair : replacements)
+		{
+			range_t const range = pair.first.sorted();
+			if(range.first.index == range.last.index && pair.second.empty())
+				continue; // like replace_helper() we leave the caret alone, including the carry of a freehanded caret
+
+			std::string const pad = range.freehanded && range.first.carry ? std::string(range.first.carry, ' ') : "";
+			edits.emplace_back(range.first.index, range.last.index, pad + pair.second);
+		}
+
+		if(!edits.empty())
+			buffer.replace(edits);
+
+		ranges_t res;
+		ssize_t adjustment = 0;
+		auto edit = edits.begin();
+		for(auto const& pair : replacements)
+		{
+			range_t const range = pair.first.sorted();
+			if(range.first.index == range.last.index && pair.second.empty())
+			{
+				res.push_back(range + adjustment);
+				continue;
+			}
+
+			size_t const from = edit->from + adjustment;
+			size_t const pad  = edit->str.size() - pair.second.size();
+			res.push_back(range_t(from + pad, from + edit->str.size(), false, range.freehanded, true));
+			res.last().color = range.color;
+			adjustment += edit->str.size() - (edit->to - edit->from);
+			++edit;
+		}
+		return res;
+	}
+
 	static ranges_t replace_helper (ng::buffer_t& buffer, snippet_controller_t& snippets, std::multimap<range_t, std::string> const& replacements)
 	{
+		if(snippets.empty() && replacements.size() > 1 && is_non_overlapping(replacements))
+			return bulk_replace_helper(buffer, replacements);
+
 		ranges_t res;
 
 		ssize_t adjustment = 0;
@@ -1506,15 +1562,18 @@ namespace ng
 		ranges_t res;
 		if(options & find::all_matches)
 		{
-			for(auto const& pair : ng::find_all(_buffer, searchFor, options, searchOnlySelection ? _selections : ranges_t()))
-				res.push_back(pair.first);
-
+			// Only the ranges are used so we do not ask for the captures of each match
+			auto allMatches = [&](ranges_t const& searchRanges){
+				ranges_t matches;
+				ng::each_match(_buffer, searchFor, options, searchRanges, false, [&matches](range_t const& range, std::map<std::string, std::string> const*, bool*){
+					matches.push_back(range);
+				});
+				return matches;
+			};
+
+			res = allMatches(searchOnlySelection ? _selections : ranges_t());
 			if(searchOnlySelection && res.sorted() == _selections.sorted())
-			{
-				res = ranges_t();
-				for(auto const& pair : ng::find_all(_buffer, searchFor, options, ranges_t()))
-					res.push_back(pair.first);
-			}
+				res = allMatches(ranges_t());
 		}
 		else
 		{
@@ -1533,7 +1592,10 @@ namespace ng
 	ranges_t editor_t::replace_all (std::string const& searchFor, std::string const& replaceWith, find::options_t options, bool searchOnlySelection)
 	{
 		ranges_t res;
-		if(options & find::all_matches)
+		if(!(options & find::all_matches))
+			return res;
+
+		if(!_snippets.empty())
 		{
 			preserve_selection_helper_t helper(_buffer, _selections);
 			std::multimap<range_t, std::string> replacements;
@@ -1541,6 +1603,52 @@ namespace ng
 				replacements.emplace(pair.first, options & find::regular_expression ? format_string::expand(replaceWith, pair.second) : replaceWith);
 			res = this->replace(replacements, true);
 			_selections = helper.get();
+			return res;
+		}
+
+		bool const expandFormat = options & find::regular_expression;
+
+		std::vector<range_t> matches;
+		std::vector<std::map<std::string, std::string>> captures;
+		ng::each_match(_buffer, searchFor, options, searchOnlySelection ? _selections : ranges_t(), expandFormat, [&](range_t const& range, std::map<std::string, std::string> const* matchCaptures, bool*){
+			if(!matches.empty() && range.min() < matches.back().max())
+				return; // overlapping match, find_all would have kept both but only the first can be replaced
+			matches.push_back(range);
+			if(expandFormat)
+				captures.push_back(*matchCaptures);
+		});
+
+		if(matches.empty())
+			return res;
+
+		// Format strings only depend on their own captures, so they can be expanded concurrently
+		std::vector<std::string> strings(matches.size(), replaceWith);
+		if(expandFormat)
+		{
+			std::string const* format = &replaceWith;
+			std::map<std::string, std::string> const* variables = captures.data();
+			std::string* out = strings.data();
+			size_t const count = strings.size(), stride = 1024;
+			dispatch_apply((count + stride - 1) / stride, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t n){
+				for(size_t i = n * stride; i < std::min((n + 1) * stride, count); ++i)
+					out[i] = format_string::expand(*format, variables[i]);
+			});
+		}
+
+		std::vector<replacement_t> replacements;
+		replacements.reserve(matches.size());
+		for(size_t i = 0; i < matches.size(); ++i)
+			replacements.emplace_back(matches[i].min().index, matches[i].max().index, strings[i]);
+
+		preserve_selection_helper_t helper(_buffer, _selections);
+		_buffer.replace(replacements);
+		_selections = helper.get();
+
+		ssize_t delta = 0;
+		for(auto const& r : replacements)
+		{
+			res.push_back(range_t(r.from + delta, r.from + delta + r.str.size(), false, false, true));
+			delta += r.str.size() - (r.to - r.from);
 		}
 		return res;
 	}
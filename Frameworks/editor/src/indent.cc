@@ -1,11 +1,13 @@
 #include "indent.h"
 #include <bundles/src/bundles.h>
 
-namespace indent
+namespace
 {
-	std::map<indent::pattern_type, regexp::pattern_t> patterns_for_scope (scope::context_t const& scope)
+	typedef std::map<indent::pattern_type, regexp::pattern_t> indent_patterns_t;
+
+	static indent_patterns_t indent_patterns (scope::context_t const& scope)
 	{
-		std::map<indent::pattern_type, regexp::pattern_t> res;
+		indent_patterns_t res;
 
 		static std::map<std::string, indent::pattern_type> const map =
 		{
@@ -27,4 +29,19 @@ namespace indent
 		return res;
 	}
 
+	static bundles::settings_cache_t<scope::context_t, indent_patterns_t>& pattern_cache ()
+	{
+		static auto* cache = new bundles::settings_cache_t<scope::context_t, indent_patterns_t>(&indent_patterns, 4096);
+		return *cache;
+	}
+}
+
+namespace indent
+{
+	std::map<indent::pattern_type, regexp::pattern_t> patterns_for_scope (scope::context_t const& scope)
+	{
+		// Lines mostly share a handful of scopes so this saves five bundle setting queries per line when re-indenting
+		return pattern_cache().lookup(scope);
+	}
+
 } /* indent */
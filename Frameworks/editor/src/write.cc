@@ -13,6 +13,59 @@ namespace ng
 		return len + caret.carry;
 	}
 
+	namespace
+	{
+		// Collects small pieces (XML tags, escaped text) into a fixed size buffer, larger pieces are written directly
+		struct fd_writer_t
+		{
+			fd_writer_t (int fd) : _fd(fd) { _buffer.reserve(kBufferSize); }
+
+			bool write (char const* data, size_t len)
+			{
+				if(_buffer.size() + len > kBufferSize && !flush())
+					return false;
+				if(len >= kBufferSize)
+					return write_all(data, len);
+				_buffer.insert(_buffer.end(), data, data + len);
+				return true;
+			}
+
+			bool flush ()
+			{
+				bool res = write_all(_buffer.data(), _buffer.size());
+				_buffer.clear();
+				return res;
+			}
+
+		private:
+			static size_t const kBufferSize = 64*1024;
+
+			bool write_all (char const* data, size_t len)
+			{
+				while(len && !_failed)
+				{
+					ssize_t n = ::write(_fd, data, len);
+					if(n == -1 && errno != EINTR)
+					{
+						if(errno != EPIPE) // command exited without reading all input
+							perror("ng::write_unit_to_fd: write");
+						_failed = true;
+					}
+					else if(n > 0)
+					{
+						data += n;
+						len  -= n;
+					}
+				}
+				return !_failed;
+			}
+
+			int _fd;
+			std::vector<char> _buffer;
+			bool _failed = false;
+		};
+	}
+
 	ng::ranges_t write_unit_to_fd (buffer_api_t const& buffer, ranges_t const& ranges, size_t tabSize, int fd, input::type unit, input::type fallbackUnit, input_format::type format, scope::selector_t const& scopeSelector, std::map<std::string, std::string>& variables, bool* inputWasSelection) // TODO Move write_unit_to_fd to command framework.
 	{
 		bool noSelection = true;
@@ -41,18 +94,24 @@ namespace ng
 
 		if(res.size() != 1 || !res.last().empty())
 		{
-			std::string str = "";
-			bool first = true;
+			// Snapshots share the buffer’s memory, so the input is streamed to the pipe in pieces (blocking when it is full) instead of being copied into one string first
+			std::vector<snapshot_t> snapshots;
 			for(auto const& range : dissect_columnar(buffer, res))
-			{
-				if(!std::exchange(first, false))
-					str += "\n";
-				str += format == input_format::xml ? buffer.xml_substr(range.min().index, range.max().index) : buffer.substr(range.min().index, range.max().index);
-			}
+				snapshots.push_back(buffer.snapshot(range.min().index, range.max().index, format == input_format::xml));
 
 			dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
-				if(write(fd, str.data(), str.size()) == -1)
-					perror("ng::write_unit_to_fd: write");
+				fd_writer_t writer(fd);
+				auto sink = [&writer](char const* data, size_t len){ return writer.write(data, len); };
+
+				bool first = true;
+				for(auto const& snapshot : snapshots)
+				{
+					if(!std::exchange(first, false) && !writer.write("\n", 1))
+						break;
+					if(!snapshot.write(sink))
+						break;
+				}
+				writer.flush();
 				close(fd);
 			});
 		}
@@ -0,0 +1,96 @@
+#include <editor/src/editor.h>
+#include <layout/src/layout.h>
+#include <test/benchmark.h>
+
+void test_insert_at_multiple_carets ()
+{
+	ng::buffer_t buf;
+	buf.insert(0, "foo\nbar\nbaz\n");
+
+	ng::editor_t editor(buf);
+	editor.set_selections({ ng::range_t(0), ng::range_t(4), ng::range_t(8) });
+	editor.insert("// ");
+	OAK_ASSERT_EQ(editor.as_string(), "// foo\n// bar\n// baz\n");
+	OAK_ASSERT_EQ(to_s(editor.ranges()), "[3]&[10]&[17]");
+
+	editor.set_selections({ ng::range_t(3, 6), ng::range_t(10, 13), ng::range_t(17, 20) });
+	editor.insert("x");
+	OAK_ASSERT_EQ(editor.as_string(), "// x\n// x\n// x\n");
+	OAK_ASSERT_EQ(to_s(editor.ranges()), "[4]&[9]&[14]");
+
+	editor.set_selections({ ng::range_t(0, 3), ng::range_t(5, 8), ng::range_t(10, 13) });
+	editor.perform(ng::kDeleteSelection);
+	OAK_ASSERT_EQ(editor.as_string(), "x\nx\nx\n");
+	OAK_ASSERT_EQ(to_s(editor.ranges()), "[0]&[2]&[4]");
+}
+
+void test_freehanded_caret_at_multiple_carets ()
+{
+	ng::buffer_t buf;
+	buf.insert(0, "foo\nbar\nbaz\n");
+
+	ng::editor_t editor(buf);
+	editor.set_selections({ ng::range_t(0, 3), ng::range_t(ng::index_t(7, 3)) });
+	editor.perform(ng::kDeleteSelection);
+	OAK_ASSERT_EQ(editor.as_string(), "\nbar\nbaz\n");
+	OAK_ASSERT_EQ(to_s(editor.ranges()), "[0]&[4:3]");
+
+	editor.insert("x");
+	OAK_ASSERT_EQ(editor.as_string(), "x\nbar   x\nbaz\n");
+	OAK_ASSERT_EQ(to_s(editor.ranges()), "[1]&[9]");
+}
+
+// Multiple carets edit the buffer with a bulk replace, the layout must end up with the same rows as one created from the result
+static void check_layout (ng::layout_t const& layout, ng::buffer_t const& buf)
+{
+	ng::buffer_t expectedBuf;
+	expectedBuf.insert(0, buf.substr(0, buf.size()));
+	ng::layout_t expected(expectedBuf, layout.theme(), layout.font_name(), layout.font_size());
+
+	OAK_ASSERT(layout.structural_integrity());
+	OAK_ASSERT_EQ(layout.to_s(), expected.to_s());
+}
+
+void test_layout_at_multiple_carets ()
+{
+	ng::buffer_t buf;
+	buf.insert(0, "foo\nbar\nbaz\n");
+	ng::layout_t layout(buf, parse_theme(bundles::item_ptr()), "Menlo", 12);
+
+	ng::editor_t editor(buf);
+	editor.set_selections({ ng::range_t(0), ng::range_t(4), ng::range_t(8) });
+	editor.insert("XX");
+	OAK_ASSERT_EQ(editor.as_string(), "XXfoo\nXXbar\nXXbaz\n");
+	check_layout(layout, buf);
+
+	editor.set_selections({ ng::range_t(1), ng::range_t(3), ng::range_t(7) });
+	editor.insert("\n");
+	OAK_ASSERT_EQ(editor.as_string(), "X\nXf\noo\nX\nXbar\nXXbaz\n");
+	check_layout(layout, buf);
+
+	editor.set_selections({ ng::range_t(1, 2), ng::range_t(4, 5), ng::range_t(9, 10) });
+	editor.perform(ng::kDeleteSelection);
+	OAK_ASSERT_EQ(editor.as_string(), "XXfoo\nXXbar\nXXbaz\n");
+	check_layout(layout, buf);
+}
+
+void benchmark_insert_at_10000_carets ()
+{
+	std::string text;
+	ng::ranges_t carets;
+	for(size_t i = 0; i < 10000; ++i)
+	{
+		carets.push_back(ng::range_t(text.size()));
+		text += "int value = 42;\n";
+	}
+
+	test::benchmark("editor.insert_at_10000_carets", [&](){
+		ng::buffer_t buf;
+		buf.insert(0, text);
+
+		ng::editor_t editor(buf);
+		editor.set_selections(carets);
+		editor.insert("// ");
+		OAK_ASSERT_EQ(editor.ranges().size(), carets.size());
+	}, text.size());
+}
@@ -16,6 +16,11 @@ namespace io
 		memcpy(_bytes, str.data(), _size);
 	}
 
+	bytes_t::bytes_t (std::string&& str) : _size(str.size()), _dispose(false), _storage(std::move(str))
+	{
+		_bytes = &_storage[0];
+	}
+
 	bytes_t::bytes_t (char const* bytes, size_t size, bool dispose) : _bytes((char*)bytes), _size(size), _dispose(dispose)
 	{
 	}
@@ -33,6 +38,17 @@ namespace io
 		_bytes   = new char[_size = str.size()];
 		_dispose = true;
 		memcpy(_bytes, str.data(), _size);
+		std::string().swap(_storage);
+	}
+
+	void bytes_t::set_string (std::string&& str)
+	{
+		if(_dispose)
+			delete[] _bytes;
+		_storage = std::move(str);
+		_bytes   = &_storage[0];
+		_size    = _storage.size();
+		_dispose = false;
 	}
 
 	uint32_t bytes_t::crc32 () const
@@ -12,6 +12,7 @@ namespace io
 	{
 		bytes_t (size_t size);
 		bytes_t (std::string const& str);
+		bytes_t (std::string&& str);
 		bytes_t (char const* bytes, size_t size, bool dispose = true);
 		~bytes_t ();
 
@@ -25,12 +26,14 @@ namespace io
 		void resize (size_t size)  { _size = size; }
 
 		void set_string (std::string const& str);
+		void set_string (std::string&& str);
 		uint32_t crc32 () const;
 
 	private:
 		char* _bytes;
 		size_t _size;
 		bool _dispose;
+		std::string _storage; // adopted by the rvalue constructor / set_string to avoid a copy
 	};
 
 	typedef std::shared_ptr<bytes_t> bytes_ptr;
@@ -28,9 +28,10 @@ namespace encoding
 		if(auto transcode = text::transcode_t(from, to))
 		{
 			std::string buffer;
+			buffer.reserve(content->size());
 			transcode(transcode(content->begin(), content->end(), back_inserter(buffer)));
 			if(transcode.invalid_count() == 0)
-				res = std::make_shared<io::bytes_t>(buffer);
+				res = std::make_shared<io::bytes_t>(std::move(buffer));
 		}
 
 		return res;
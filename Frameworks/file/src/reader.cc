@@ -4,11 +4,14 @@
 #include <text/src/utf8.h>
 #include <io/src/path.h>
 #include <settings/src/settings.h>
+#include <oak/trace.h>
 
 namespace file
 {
 	reader_t::reader_t (std::string const& path) : _path(path)
 	{
+		oak::trace::span_t span("file", "open", _path);
+
 		_fd = open(_path.c_str(), O_RDONLY|O_CLOEXEC);
 		if(_fd == -1)
 		{
@@ -44,6 +47,8 @@ namespace file
 
 	io::bytes_ptr reader_t::next ()
 	{
+		oak::trace::span_t span("file", "read", _path);
+
 		if(_fd == -1)
 			return io::bytes_ptr();
 
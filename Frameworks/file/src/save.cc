@@ -102,6 +102,45 @@ namespace
 
 namespace
 {
+	static size_t const kWriteChunkSize = 1024*1024;
+
+	// write(2) fails with EINVAL for requests above INT_MAX and may return
+	// short counts, so large documents are written in bounded chunks.
+	static bool write_all (int fd, char const* bytes, size_t len, std::string* error)
+	{
+		while(len)
+		{
+			ssize_t res = write(fd, bytes, std::min(len, kWriteChunkSize));
+			if(res == -1 && errno == EINTR)
+				continue;
+			if(res == -1)
+			{
+				*error = text::format("write: %s", strerror(errno));
+				return false;
+			}
+			bytes += res;
+			len   -= res;
+		}
+		return true;
+	}
+
+	static void convert_newlines (io::bytes_ptr content, std::string const& newlines)
+	{
+		size_t const count = std::count(content->begin(), content->end(), '\n');
+		if(count == 0)
+			return;
+
+		if(newlines.size() == 1) // CR is a same-size substitution, do it in place
+		{
+			std::replace(content->begin(), content->end(), '\n', newlines.front());
+			return;
+		}
+
+		std::string tmp(content->size() + count * (newlines.size() - 1), '\0');
+		oak::replace_copy(content->begin(), content->end(), kLF.begin(), kLF.end(), newlines.begin(), newlines.end(), tmp.begin());
+		content->set_string(std::move(tmp));
+	}
+
 	static std::string write_to_path (std::string const& path, io::bytes_ptr const& bytes, std::map<std::string, std::string> const& attributes, osx::authorization_t authorization)
 	{
 		std::string error = NULL_STR;
@@ -133,8 +172,10 @@ namespace
 			int fd = dest.open(&error);
 			if(fd == -1)
 				;
-			else if(write(fd, bytes->get(), bytes->size()) != bytes->size())
-				error = text::format("write: %s", strerror(errno));
+			else if(!write_all(fd, bytes->get(), bytes->size(), &error))
+				;
+			else if(fsync(fd) == -1)
+				error = text::format("fsync: %s", strerror(errno));
 			else if(!dest.close(&error))
 				;
 			else if(!path::set_attributes(path, attributes))
@@ -144,7 +185,8 @@ namespace
 		{
 			if(connection_t conn = connect_to_auth_server(authorization))
 			{
-				conn << "write" << path << std::string(bytes->begin(), bytes->end()) << attributes;
+				conn << "write" << path;
+				conn.write(bytes->get(), bytes->size()) << attributes;
 				conn >> error;
 			}
 			else
@@ -272,11 +314,7 @@ namespace
 					_next_state = kStateEncodeContent;
 
 					if(_encoding.newlines() != kLF)
-					{
-						std::string tmp;
-						oak::replace_copy(_content->begin(), _content->end(), kLF.begin(), kLF.end(), _encoding.newlines().begin(), _encoding.newlines().end(), back_inserter(tmp));
-						_content->set_string(tmp);
-					}
+						convert_newlines(_content, _encoding.newlines());
 
 					proceed();
 				}
@@ -11,17 +11,6 @@
 // = File Type Support =
 // =====================
 
-static std::string file_type_from_grammars (std::vector<bundles::item_ptr> const& grammars)
-{
-	for(auto const& grammar : grammars)
-	{
-		std::string const& scopeName = grammar->value_for_field(bundles::kFieldGrammarScope);
-		if(scopeName != NULL_STR)
-			return scopeName;
-	}
-	return NULL_STR;
-}
-
 static size_t lines_matched_by_regexp (std::string const& pattern)
 {
 	size_t newlines = 1;
@@ -51,18 +40,104 @@ _InputIter first_n_lines (_InputIter const& first, _InputIter const& last, size_
 	return eol;
 }
 
-static std::vector<bundles::item_ptr> grammars_for_path (std::string const& path)
+namespace
 {
-	std::multimap<ssize_t, bundles::item_ptr> ordering;
-	for(auto const& item : bundles::query(bundles::kFieldAny, NULL_STR, scope::wildcard, bundles::kItemTypeGrammar))
+	// ================
+	// = type_index_t =
+	// ================
+
+	// Grammar extensions and first line patterns, collected once per bundle index.
+	// Grammars are numbered in query order which is used to break ties.
+
+	struct type_index_t
 	{
-		for(auto const& ext : item->values_for_field(bundles::kFieldGrammarExtension))
+		type_index_t ()
+		{
+			for(auto const& item : bundles::query(bundles::kFieldAny, NULL_STR, scope::wildcard, bundles::kItemTypeGrammar))
+			{
+				size_t const grammar = _scopes.size();
+				_scopes.push_back(item->value_for_field(bundles::kFieldGrammarScope));
+
+				for(auto const& ext : item->values_for_field(bundles::kFieldGrammarExtension))
+				{
+					std::vector<size_t>& grammars = _extensions[ext];
+					if(grammars.empty() || grammars.back() != grammar)
+						grammars.push_back(grammar);
+				}
+
+				for(auto const& pattern : item->values_for_field(bundles::kFieldGrammarFirstLineMatch))
+					_first_line_matches.push_back({ grammar, pattern, pattern.find("(?m)") == std::string::npos ? lines_matched_by_regexp(pattern) : SIZE_T_MAX });
+			}
+		}
+
+		// Only suffixes starting after a separator (or the full path) can have a non-zero path::rank(), so we look up those instead of testing every extension
+		std::string type_from_path (std::string const& path) const
+		{
+			size_t bestRank = 0, bestGrammar = SIZE_T_MAX;
+			for(size_t i = 0; i <= path.size(); ++i)
+			{
+				if(i != 0 && path[i-1] != '.' && path[i-1] != '_' && path[i-1] != '/')
+					continue;
+
+				auto it = _extensions.find(path.substr(i));
+				if(it == _extensions.end())
+					continue;
+
+				size_t const rank = path::rank(path, it->first);
+				if(rank && (bestRank < rank || (bestRank == rank && it->second.front() < bestGrammar)))
+				{
+					bestRank    = rank;
+					bestGrammar = it->second.front();
+				}
+			}
+			return bestRank ? _scopes[bestGrammar] : NULL_STR;
+		}
+
+		std::string type_from_bytes (char const* first, char const* last) const
 		{
-			if(ssize_t rank = path::rank(path, ext))
-				ordering.emplace(-rank, item);
+			std::map<size_t, char const*> endOfLines; // number of lines → end of those lines
+			ssize_t bestEnd = -1;
+			size_t bestGrammar = SIZE_T_MAX;
+
+			for(auto const& firstLineMatch : _first_line_matches)
+			{
+				auto eol = endOfLines.find(firstLineMatch.lines);
+				if(eol == endOfLines.end())
+					eol = endOfLines.emplace(firstLineMatch.lines, firstLineMatch.lines == SIZE_T_MAX ? last : first_n_lines(first, last, firstLineMatch.lines)).first;
+
+				if(regexp::match_t const& m = regexp::search(firstLineMatch.pattern, first, eol->second))
+				{
+					if(bestEnd < (ssize_t)m.end())
+					{
+						bestEnd     = m.end();
+						bestGrammar = firstLineMatch.grammar;
+					}
+				}
+			}
+			return bestGrammar != SIZE_T_MAX ? _scopes[bestGrammar] : NULL_STR;
 		}
+
+	private:
+		struct first_line_match_t
+		{
+			size_t grammar;
+			regexp::pattern_t pattern;
+			size_t lines; // SIZE_T_MAX for multi-line patterns, i.e. those using (?m)
+		};
+
+		std::vector<std::string> _scopes;
+		std::map<std::string, std::vector<size_t>> _extensions;
+		std::vector<first_line_match_t> _first_line_matches;
+	};
+
+	// There is a single index for all bundles, built on first use after bundles change
+	static std::shared_ptr<type_index_t const> type_index ()
+	{
+		static auto* cache = new bundles::settings_cache_t<bool, std::shared_ptr<type_index_t const>>([](bool){
+			return std::make_shared<type_index_t const>();
+		}, 1);
+		return cache->lookup(true);
 	}
-	return ordering.empty() ? std::vector<bundles::item_ptr>() : std::vector<bundles::item_ptr>{ ordering.begin()->second };
 }
 
 static bool unknown_file_type (std::string const& fileType)
@@ -110,29 +185,12 @@ namespace file
 {
 	std::string type_from_bytes (io::bytes_ptr const& bytes)
 	{
-		if(!bytes)
-			return NULL_STR;
-
-		std::multimap<ssize_t, bundles::item_ptr> ordering;
-		for(auto const& item : bundles::query(bundles::kFieldAny, NULL_STR, scope::wildcard, bundles::kItemTypeGrammar))
-		{
-			for(auto const& pattern : item->values_for_field(bundles::kFieldGrammarFirstLineMatch))
-			{
-				char const* first = bytes->begin();
-				char const* last  = bytes->end();
-				if(pattern.find("(?m)") == std::string::npos)
-					last = first_n_lines(first, last, lines_matched_by_regexp(pattern));
-
-				if(regexp::match_t const& m = regexp::search(pattern, first, last))
-					ordering.emplace(-m.end(), item);
-			}
-		}
-		return ordering.empty() ? NULL_STR : file_type_from_grammars(std::vector<bundles::item_ptr>(1, ordering.begin()->second));
+		return bytes ? type_index()->type_from_bytes(bytes->begin(), bytes->end()) : NULL_STR;
 	}
 
 	std::string type_from_path (std::string const& path)
 	{
-		return path != NULL_STR ? file_type_from_grammars(grammars_for_path(path)) : NULL_STR;
+		return path != NULL_STR ? type_index()->type_from_path(path) : NULL_STR;
 	}
 
 	std::string type (std::string const& path, io::bytes_ptr const& bytes, std::string const& virtualPath)
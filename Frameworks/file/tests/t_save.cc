@@ -97,6 +97,25 @@ void test_save_untitled_failure ()
 	OAK_ASSERT_EQ(success, false);
 }
 
+void test_save_newlines ()
+{
+	test::jail_t jail;
+
+	std::string const content = "line 1\nline 2\n\nline 4";
+	for(auto const& pair : { std::make_pair(std::string("\r\n"), std::string("line 1\r\nline 2\r\n\r\nline 4")), std::make_pair(std::string("\r"), std::string("line 1\rline 2\r\rline 4")) })
+	{
+		bool success     = false;
+		std::string path = jail.path("test.txt");
+
+		auto cb = std::make_shared<stall_t>(&success);
+		file::save(path, cb, osx::authorization_t(), io::bytes_ptr(new io::bytes_t(content)), std::map<std::string, std::string>(), encoding::type(pair.first, "UTF-8"), std::vector<oak::uuid_t>() /* binary import filters */, std::vector<oak::uuid_t>() /* text import filters */);
+		cb->wait();
+
+		OAK_ASSERT_EQ(success, true);
+		OAK_ASSERT_EQ(path::content(path), pair.second);
+	}
+}
+
 void test_save_translit ()
 {
 	test::jail_t jail;
@@ -3,6 +3,7 @@
 #include <test/jail.h>
 #include <regexp/src/glob.h>
 #include <settings/src/settings.h>
+#include <plist/ascii.h>
 
 void test_file_type ()
 {
@@ -14,6 +15,24 @@ void test_file_type ()
 	OAK_ASSERT_EQ(file::type(jail.path("ascii.plist"), io::bytes_ptr(new io::bytes_t("{ foo = 'bar'; }"))), "source.plist");
 }
 
+void test_type_index_invalidation ()
+{
+	std::string const firstLine = "#!/usr/bin/env xyz\n";
+	OAK_ASSERT_EQ(file::type_from_path("/path/to/foo.xyz"), NULL_STR);
+	OAK_ASSERT_EQ(file::type_from_bytes(io::bytes_ptr(new io::bytes_t(firstLine))), NULL_STR);
+
+	auto grammar = std::make_shared<bundles::item_t>(oak::uuid_t("6F4A3F2C-61B6-4C8E-9D2A-5E1C0B7D8A93"), bundles::item_ptr(), bundles::kItemTypeGrammar);
+	grammar->set_plist(boost::get<plist::dictionary_t>(plist::parse_ascii("{ fileTypes = ( xyz ); firstLineMatch = '^#!.*\\bxyz\\b'; scopeName = 'source.xyz'; uuid = '6F4A3F2C-61B6-4C8E-9D2A-5E1C0B7D8A93'; }")));
+
+	bundles::add_item(grammar);
+	OAK_ASSERT_EQ(file::type_from_path("/path/to/foo.xyz"), "source.xyz");
+	OAK_ASSERT_EQ(file::type_from_bytes(io::bytes_ptr(new io::bytes_t(firstLine))), "source.xyz");
+
+	bundles::remove_item(grammar);
+	OAK_ASSERT_EQ(file::type_from_path("/path/to/foo.xyz"), NULL_STR);
+	OAK_ASSERT_EQ(file::type_from_bytes(io::bytes_ptr(new io::bytes_t(firstLine))), NULL_STR);
+}
+
 void test_create_glob ()
 {
 	test::jail_t jail;
@@ -1,4 +1,5 @@
 #include "folds.h"
+#include <bundles/src/bundles.h>
 #include <bundles/src/wrappers.h>
 #include <regexp/src/indent.h>
 #include <plist/src/ascii.h>
@@ -7,6 +8,64 @@
 #include <oak/algorithm.h>
 #include <oak/oak.h>
 
+namespace
+{
+	// =================
+	// = Fold Patterns =
+	// =================
+
+	struct fold_patterns_t
+	{
+		regexp::pattern_t start, stop, indent, ignore;
+	};
+
+	typedef std::pair<scope::context_t, scope::scope_t> fold_patterns_key_t; // scope and root scope
+
+	static fold_patterns_t patterns_for_scope (fold_patterns_key_t const& key)
+	{
+		scope::context_t const& scope    = key.first;
+		scope::scope_t const& rootScope = key.second;
+
+		fold_patterns_t res;
+
+		struct { regexp::pattern_t& regexp; std::string setting; } mapping[] =
+		{
+			{ res.start,  "foldingStartMarker"         },
+			{ res.stop,   "foldingStopMarker"          },
+			{ res.indent, "foldingIndentedBlockStart"  },
+			{ res.ignore, "foldingIndentedBlockIgnore" },
+		};
+
+		for(auto info : mapping)
+		{
+			plist::any_t ptrn = bundles::value_for_setting(info.setting, scope);
+			if(std::string const* str = boost::get<std::string>(&ptrn))
+				info.regexp = *str;
+		}
+
+		// legacy — grammars can carry their own markers
+		if(!res.start && !res.stop && !res.indent && !res.ignore)
+		{
+			for(auto const& item : bundles::query(bundles::kFieldGrammarScope, to_s(rootScope), scope::wildcard, bundles::kItemTypeGrammar))
+			{
+				std::string foldingStartMarker = NULL_STR, foldingStopMarker = NULL_STR;
+				plist::get_key_path(item->plist(), "foldingStartMarker", foldingStartMarker);
+				plist::get_key_path(item->plist(), "foldingStopMarker", foldingStopMarker);
+				res.start = foldingStartMarker;
+				res.stop  = foldingStopMarker;
+			}
+		}
+
+		return res;
+	}
+
+	static bundles::settings_cache_t<fold_patterns_key_t, fold_patterns_t>& pattern_cache ()
+	{
+		static auto* cache = new bundles::settings_cache_t<fold_patterns_key_t, fold_patterns_t>(&patterns_for_scope, 4096);
+		return *cache;
+	}
+}
+
 namespace ng
 {
 	folds_t::folds_t (buffer_t& buffer) : _buffer(buffer) { _buffer.add_callback(this);    }
@@ -183,10 +242,11 @@ namespace ng
 			{
 				if(recursive)
 				{
-					for(auto const& pair : foldable_ranges())
+					auto const& ranges = foldable_ranges();
+					for(auto it = std::lower_bound(ranges.begin(), ranges.end(), std::make_pair(res.first, size_t(0))); it != ranges.end() && it->first <= res.second; ++it)
 					{
-						if(res.first <= pair.first && pair.second <= res.second)
-							fold(pair.first, pair.second);
+						if(it->second <= res.second)
+							fold(it->first, it->second);
 					}
 				}
 				else
@@ -254,6 +314,7 @@ namespace ng
 		_levels.replace(from, to, len);
 		_levels.remove(_buffer.begin(_buffer.convert(from).line));
 		_levels.remove(_buffer.begin(_buffer.convert(to).line));
+		_foldable_ranges_valid = false;
 	}
 
 	void folds_t::did_parse (size_t from, size_t to)
@@ -261,14 +322,18 @@ namespace ng
 		auto fromIter = _levels.lower_bound(_buffer.begin(_buffer.convert(from).line));
 		auto toIter   = _levels.lower_bound(_buffer.begin(_buffer.convert(to).line));
 		_levels.remove(fromIter, toIter != _levels.end() ? ++toIter : toIter);
+		_foldable_ranges_valid = false;
 	}
 
 	// ============
 	// = Internal =
 	// ============
 
-	std::vector< std::pair<size_t, size_t> > folds_t::foldable_ranges () const
+	std::vector< std::pair<size_t, size_t> > const& folds_t::foldable_ranges () const
 	{
+		if(_foldable_ranges_valid)
+			return _foldable_ranges;
+
 		std::vector< std::pair<size_t, size_t> > res;
 
 		std::vector< std::pair<size_t, int> > regularStack;
@@ -317,62 +382,40 @@ namespace ng
 
 		std::sort(res.begin(), res.end());
 
-		std::vector< std::pair<size_t, size_t> > nestingStack, unique;
+		_foldable_ranges.clear();
+		_enclosing_range.clear();
+
+		std::vector<size_t> nestingStack;
 		for(auto const& pair : res)
 		{
-			while(!nestingStack.empty() && nestingStack.back().second <= pair.first)
+			while(!nestingStack.empty() && _foldable_ranges[nestingStack.back()].second <= pair.first)
 				nestingStack.pop_back();
-			if(!nestingStack.empty() && nestingStack.back().second < pair.second)
+			if(!nestingStack.empty() && _foldable_ranges[nestingStack.back()].second < pair.second)
 				continue;
-			nestingStack.push_back(pair);
-			unique.push_back(pair);
+			_enclosing_range.push_back(nestingStack.empty() ? -1 : nestingStack.back());
+			nestingStack.push_back(_foldable_ranges.size());
+			_foldable_ranges.push_back(pair);
 		}
-		return unique;
+
+		_foldable_ranges_valid = true;
+		return _foldable_ranges;
 	}
 
 	std::pair<size_t, size_t> folds_t::foldable_range_at_line (size_t n) const
 	{
-		std::pair<size_t, size_t> res(0, 0);
-
 		size_t bol = _buffer.begin(n), eol = _buffer.eol(n);
-		for(auto const& pair : foldable_ranges())
-		{
-			if(std::clamp(bol, pair.first, pair.second) == bol || std::clamp(eol, pair.first, pair.second) == eol)
-				res = pair;
-		}
-		return res;
-	}
-
-	static void setup_patterns (ng::buffer_t const& buffer, size_t line, regexp::pattern_t& startPattern, regexp::pattern_t& stopPattern, regexp::pattern_t& indentPattern, regexp::pattern_t& ignorePattern)
-	{
-		struct { regexp::pattern_t& regexp; std::string setting; } mapping[] =
-		{
-			{ startPattern,  "foldingStartMarker"         },
-			{ stopPattern,   "foldingStopMarker"          },
-			{ indentPattern, "foldingIndentedBlockStart"  },
-			{ ignorePattern, "foldingIndentedBlockIgnore" },
-		};
-
-		scope::context_t scope(buffer.scope(buffer.begin(line), false).right, buffer.scope(buffer.end(line), false).left);
-		for(auto info : mapping)
-		{
-			plist::any_t ptrn = bundles::value_for_setting(info.setting, scope);
-			if(std::string const* str = boost::get<std::string>(&ptrn))
-				info.regexp = *str;
-		}
+		auto const& ranges = foldable_ranges();
 
-		// legacy — this has bad performance
-		if(!startPattern && !stopPattern && !indentPattern && !ignorePattern)
+		// Find the last range (in sorted order) touching the line. Ranges ending before the line can be skipped by going to their enclosing range as no earlier sibling extends past them
+		ssize_t i = std::upper_bound(ranges.begin(), ranges.end(), std::make_pair(eol, SIZE_T_MAX)) - ranges.begin() - 1;
+		while(i != -1)
 		{
-			for(auto const& item : bundles::query(bundles::kFieldGrammarScope, to_s(buffer.scope(0, false).left), scope::wildcard, bundles::kItemTypeGrammar))
-			{
-				std::string foldingStartMarker = NULL_STR, foldingStopMarker = NULL_STR;
-				plist::get_key_path(item->plist(), "foldingStartMarker", foldingStartMarker);
-				plist::get_key_path(item->plist(), "foldingStopMarker", foldingStopMarker);
-				startPattern = foldingStartMarker;
-				stopPattern  = foldingStopMarker;
-			}
+			auto const& pair = ranges[i];
+			if(std::clamp(bol, pair.first, pair.second) == bol || std::clamp(eol, pair.first, pair.second) == eol)
+				return pair;
+			i = pair.second < bol ? _enclosing_range[i] : i-1;
 		}
+		return std::pair<size_t, size_t>(0, 0);
 	}
 
 	folds_t::value_t folds_t::info_for (size_t n) const
@@ -382,16 +425,16 @@ namespace ng
 		if(it != _levels.end())
 			return it->second;
 
-		regexp::pattern_t startPattern, stopPattern, indentPattern, ignorePattern;
-		setup_patterns(_buffer, n, startPattern, stopPattern, indentPattern, ignorePattern);
+		scope::context_t const scope(_buffer.scope(bol, false).right, _buffer.scope(_buffer.end(n), false).left);
+		fold_patterns_t const patterns = pattern_cache().lookup({ scope, _buffer.scope(0, false).left });
 
 		std::string const line = _buffer.substr(bol, _buffer.eol(n));
 
 		value_t info;
-		info.start_marker        = !!regexp::search(startPattern,  line);
-		info.stop_marker         = !!regexp::search(stopPattern,   line);
-		info.indent_start_marker = !!regexp::search(indentPattern, line);
-		info.ignore_line         = !!regexp::search(ignorePattern, line);
+		info.start_marker        = !!regexp::search(patterns.start,  line);
+		info.stop_marker         = !!regexp::search(patterns.stop,   line);
+		info.indent_start_marker = !!regexp::search(patterns.indent, line);
+		info.ignore_line         = !!regexp::search(patterns.ignore, line);
 		info.empty_line          = text::is_blank(line.data(), line.data() + line.size());
 		info.indent              = indent::leading_whitespace(line.data(), line.data() + line.size(), _buffer.indent().tab_size());
 
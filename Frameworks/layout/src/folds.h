@@ -46,7 +46,7 @@ namespace ng
 		static std::string info_to_s (oak::basic_tree_t<size_t, value_t>::value_type const& info) { return text::format("%zu: %zu + %zu", info.offset + info.key, info.offset, info.key); }
 
 		void set_folded (std::vector< std::pair<size_t, size_t> > const& newFoldings);
-		std::vector< std::pair<size_t, size_t> > foldable_ranges () const;
+		std::vector< std::pair<size_t, size_t> > const& foldable_ranges () const;
 		std::pair<size_t, size_t> foldable_range_at_line (size_t n) const;
 		value_t info_for (size_t n) const;
 
@@ -57,6 +57,12 @@ namespace ng
 		buffer_t& _buffer;
 
 		mutable indexed_map_t<value_t> _levels;
+
+		// Sorted, properly nested ranges built from _levels. Cleared when _levels change and rebuilt on demand
+		mutable std::vector< std::pair<size_t, size_t> > _foldable_ranges;
+		mutable std::vector<ssize_t> _enclosing_range; // index into _foldable_ranges or -1
+		mutable bool _foldable_ranges_valid = false;
+
 		std::vector< std::pair<size_t, size_t> > _folded;
 		indexed_map_t<bool> _legacy;
 	};
@@ -8,6 +8,7 @@
 #include <text/src/parse.h>
 #include <text/src/utf8.h>
 #include <text/src/my_ctype.h>
+#include <oak/trace.h>
 #include <oak/debug.h>
 #include <crash/src/info.h>
 
@@ -73,6 +74,7 @@ namespace ng
 		{
 			parser_callback_t (layout_t& layout) : layout(layout) { }
 			void did_replace (size_t from, size_t to, char const* buf, size_t len) { layout.did_erase(from, to); layout.did_insert(from, from + len); }
+			void did_replace_batch (std::vector<ng::replacement_t> const& replacements) { layout.did_replace(replacements); }
 
 		private:
 			layout_t& layout;
@@ -457,6 +459,8 @@ namespace ng
 
 	void layout_t::update_metrics (CGRect visibleRect)
 	{
+		oak::trace::span_t span("layout", "update_metrics");
+
 		CGFloat const yMin = CGRectGetMinY(visibleRect) - _margin.top;
 		CGFloat const yMax = CGRectGetMaxY(visibleRect) - _margin.top;
 
@@ -468,20 +472,25 @@ namespace ng
 			update_metrics_for_row(row);
 	}
 
-	bool layout_t::repair_folds (size_t from, size_t to)
+	// Outermost folded ranges, sorted and non-overlapping
+	std::vector<std::pair<size_t, size_t>> layout_t::folded_ranges () const
 	{
-		bool fullRefresh = false;
-		std::vector< std::pair<size_t, size_t> > foldedRanges;
+		std::vector< std::pair<size_t, size_t> > res;
 		ssize_t nestCount = 0;
 		for(auto const& pair : _folds->folded())
 		{
 			if(pair.second && ++nestCount == 1)
-				foldedRanges.emplace_back(pair.first, pair.first);
+				res.emplace_back(pair.first, pair.first);
 			else if(!pair.second && --nestCount == 0)
-				foldedRanges.back().second = pair.first;
+				res.back().second = pair.first;
 		}
+		return res;
+	}
 
-		for(auto const& range : foldedRanges)
+	bool layout_t::repair_folds (size_t from, size_t to)
+	{
+		bool fullRefresh = false;
+		for(auto const& range : folded_ranges())
 		{
 			if(range.second <= from || to <= range.first)
 				continue;
@@ -529,6 +538,37 @@ namespace ng
 		refresh_line_at_index(from, fullRefresh);
 	}
 
+	// The buffer already contains all replacements, but did_erase() and did_insert() read the text of the rows they touch, including the rest of the last row and folded ranges overlapping the rows. So replacements are applied first-to-last, as one edit per group, where a group extends to every replacement starting no later than the end of the line of the previous one, or of the line where a folded range touching the group ends. This way text read from the buffer never includes a replacement not yet applied to the rows.
+	void layout_t::did_replace (std::vector<ng::replacement_t> const& replacements)
+	{
+		std::vector<std::pair<size_t, size_t>> const foldedRanges = folded_ranges();
+
+		ssize_t delta = 0;
+		for(size_t i = 0; i < replacements.size(); )
+		{
+			size_t const from      = replacements[i].from + delta;
+			size_t const lineStart = _buffer.begin(_buffer.convert(from).line);
+
+			ssize_t groupDelta = 0;
+			size_t end = from, limit = 0;
+			do {
+				ng::replacement_t const& r = replacements[i++];
+				groupDelta += r.str.size() - (r.to - r.from);
+				end   = r.to + delta + groupDelta;
+				limit = std::max(limit, _buffer.end(_buffer.convert(end).line));
+				for(auto const& range : foldedRanges)
+				{
+					if(lineStart < range.second && range.first < limit)
+						limit = std::max(limit, _buffer.end(_buffer.convert(range.second).line)); // rows are joined by folds
+				}
+			} while(i < replacements.size() && replacements[i].from + delta + groupDelta <= limit);
+
+			did_erase(from, replacements[i-1].to + delta);
+			did_insert(from, end);
+			delta += groupDelta;
+		}
+	}
+
 	void layout_t::did_insert (size_t first, size_t last)
 	{
 		ASSERT_LE(first, last);
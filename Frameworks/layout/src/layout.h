@@ -151,6 +151,7 @@ namespace ng
 		void set_tab_size (size_t tabSize);
 		void did_insert (size_t first, size_t last);
 		void did_erase (size_t from, size_t to);
+		void did_replace (std::vector<ng::replacement_t> const& replacements);
 
 		void setup_font_metrics ();
 		void clear_text_widths ();
@@ -158,6 +159,7 @@ namespace ng
 		void update_metrics_for_row (row_tree_t::iterator rowIter);
 		bool update_row (row_tree_t::iterator rowIter);
 
+		std::vector<std::pair<size_t, size_t>> folded_ranges () const;
 		bool repair_folds (size_t from, size_t to);
 		void refresh_line_at_index (size_t index, bool fullRefresh);
 		void did_fold (size_t from, size_t to);
@@ -1,5 +1,6 @@
 #include <oak/basic_tree.h>
 #include <oak/oak.h>
+#include <test/benchmark.h>
 
 static int numeric_comp (ssize_t key, ssize_t const& offset, ssize_t const& node) { return key < node ? -1 : (key == node ? 0 : +1); }
 // static std::string numeric_to_s (ssize_t const& offset, ssize_t const& node)      { return std::to_string(node); }
@@ -208,3 +209,18 @@ void test_duplicates ()
 
 	OAK_ASSERT(tree.structural_integrity());
 }
+
+void benchmark_basic_tree_insert_find_erase ()
+{
+	auto keys = create_keys();
+	test::benchmark("basic_tree.insert_find_erase", [&](){
+		auto tree = create_tree(keys);
+		size_t found = 0;
+		for(ssize_t key : keys)
+			found += tree.find(key, &numeric_comp) != tree.end() ? 1 : 0;
+		OAK_ASSERT_EQ(found, keys.size());
+		for(ssize_t key : keys)
+			tree.erase(tree.find(key, &numeric_comp));
+		OAK_ASSERT(tree.empty());
+	});
+}
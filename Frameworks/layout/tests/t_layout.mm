@@ -0,0 +1,33 @@
+#import <layout/src/layout.h>
+#import <buffer/src/buffer.h>
+
+// Compares the rows of a layout that received a bulk replace with those of a layout created from the result
+static void check_bulk_replace (std::string const& text, std::vector<ng::replacement_t> const& replacements, std::string const& expectedText)
+{
+	theme_ptr theme = parse_theme(bundles::item_ptr());
+
+	ng::buffer_t buf;
+	buf.insert(0, text);
+	ng::layout_t layout(buf, theme, "Menlo", 12);
+
+	buf.replace(replacements);
+	OAK_ASSERT_EQ(buf.substr(0, buf.size()), expectedText);
+
+	ng::buffer_t expectedBuf;
+	expectedBuf.insert(0, expectedText);
+	ng::layout_t expected(expectedBuf, theme, "Menlo", 12);
+
+	OAK_ASSERT(layout.structural_integrity());
+	OAK_ASSERT_EQ(layout.to_s(), expected.to_s());
+	OAK_ASSERT_EQ(layout.softline_for_index(buf.size()), buf.lines() - 1);
+}
+
+void test_bulk_replace_layout ()
+{
+	check_bulk_replace("a\nb\n", { { 0, 0, "XX" }, { 2, 2, "XX" } }, "XXa\nXXb\n");
+	check_bulk_replace("a\nb\nc\n", { { 0, 1, "x\ny" }, { 2, 3, "" }, { 4, 5, "zzz" } }, "x\ny\n\nzzz\n");
+	check_bulk_replace("foo bar foo\nfoo\n", { { 0, 3, "f\n" }, { 8, 11, "" }, { 12, 15, "\t" } }, "f\n bar \n\t\n");
+	check_bulk_replace("a\nb\nc", { { 1, 2, "" }, { 3, 4, "" } }, "abc");
+	check_bulk_replace("one\ntwo\nthree", { { 0, 3, "1" }, { 4, 7, "2\n2" }, { 8, 13, "3" } }, "1\n2\n2\n3");
+	check_bulk_replace("a\nb\n", { { 0, 2, "\nab" }, { 3, 3, "\n" }, { 3, 4, "" } }, "\nabb\n");
+}
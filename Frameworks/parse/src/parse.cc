@@ -5,6 +5,8 @@
 #include <bundles/src/bundles.h>
 #include <text/src/utf8.h>
 #include <oak/oak.h>
+#include <oak/trace.h>
+#include <chrono>
 
 static size_t const kParserMaxLineSize = 4096;
 
@@ -96,6 +98,47 @@ namespace parse
 		return lhs == rhs || (lhs && rhs && *lhs == *rhs);
 	}
 
+	// =============
+	// = Profiling =
+	// =============
+
+	static thread_local profile_t* current_profile = nullptr;
+
+	void set_profile (profile_t* profile)
+	{
+		current_profile = profile;
+	}
+
+	enum class pattern_kind_t { match, end, while_ };
+
+	static regexp::match_t search (rule_t const* rule, pattern_kind_t kind, regexp::pattern_t const& ptrn, char const* first, char const* last, char const* from, char const* to, OnigOptionType options = ONIG_OPTION_NONE)
+	{
+		if(!current_profile)
+			return regexp::search(ptrn, first, last, from, to, options);
+
+		auto const start = std::chrono::steady_clock::now();
+		regexp::match_t res = regexp::search(ptrn, first, last, from, to, options);
+		double const elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		auto it = current_profile->rules.find(rule->rule_id);
+		if(it == current_profile->rules.end())
+		{
+			it = current_profile->rules.emplace(rule->rule_id, profile_t::rule_stats_t()).first;
+			it->second.scope        = rule->scope_string;
+			it->second.match_string = rule->match_string;
+			it->second.end_string   = rule->while_string != NULL_STR ? rule->while_string : rule->end_string;
+		}
+
+		profile_t::rule_stats_t& stats = it->second;
+		switch(kind)
+		{
+			case pattern_kind_t::match:  ++stats.match_tries; stats.match_hits += res ? 1 : 0; stats.match_time += elapsed; break;
+			case pattern_kind_t::end:    ++stats.end_tries;   stats.end_hits   += res ? 1 : 0; stats.end_time   += elapsed; break;
+			case pattern_kind_t::while_: ++stats.while_tries; stats.while_hits += res ? 1 : 0; stats.while_time += elapsed; break;
+		}
+		return res;
+	}
+
 	static bool pattern_is_format_string (std::string const& ptrn)
 	{
 		bool res = oak::contains(ptrn.begin(), ptrn.end(), '$');
@@ -314,7 +357,7 @@ namespace parse
 			}
 			else
 			{
-				auto match = regexp::search(rule->match_pattern, first, last, first + i, last, options);
+				auto match = search(rule, pattern_kind_t::match, rule->match_pattern, first, last, first + i, last, options);
 				if(!rule->match_pattern_is_anchored)
 					match_cache.emplace(rule->rule_id, match);
 				if(match)
@@ -326,6 +369,9 @@ namespace parse
 
 	static void collect_rules (char const* first, char const* last, size_t i, bool firstLine, stack_ptr const& stack, std::set<ranked_match_t>& res, std::map<size_t, regexp::match_t>& match_cache)
 	{
+		if(current_profile)
+			++current_profile->collect_rules;
+
 		std::vector<rule_t*> rules, groups, injectedRulesPre, injectedRulesPost;
 		collect_children(stack->rule->children, rules, &groups);
 		collect_injections(stack, scope::context_t(stack->scope, ""), groups, injectedRulesPre);
@@ -347,7 +393,7 @@ namespace parse
 
 		if(stack->end_pattern)
 		{
-			if(regexp::match_t const& match = regexp::search(stack->end_pattern, first, last, first + i, last, options))
+			if(regexp::match_t const& match = search(stack->rule, pattern_kind_t::end, stack->end_pattern, first, last, first + i, last, options))
 				res.emplace(stack->rule, match, stack->apply_end_last ? ++rank : endPatternRank, true);
 		}
 
@@ -382,7 +428,7 @@ namespace parse
 		scope::scope_t scope = while_rules.empty() ? stack->scope : while_rules.back()->parent->scope;
 		riterate(it, while_rules)
 		{
-			if(regexp::match_t const& m = regexp::search((*it)->while_pattern, first, last, first + i))
+			if(regexp::match_t const& m = search((*it)->rule, pattern_kind_t::while_, (*it)->while_pattern, first, last, first + i, last))
 			{
 				rule_t const* rule = (*it)->rule;
 				if(rule->scope_string != NULL_STR)
@@ -427,7 +473,7 @@ namespace parse
 			if(m.match.begin() < i)
 			{
 				regexp::pattern_t const& ptrn = m.is_end_pattern ? stack->end_pattern : m.rule->match_pattern;
-				if((m.match = regexp::search(ptrn, first, last, first + i, last, anchor_options(firstLine, stack->anchor == i, first, last))))
+				if((m.match = search(m.is_end_pattern ? stack->rule : m.rule, m.is_end_pattern ? pattern_kind_t::end : pattern_kind_t::match, ptrn, first, last, first + i, last, anchor_options(firstLine, stack->anchor == i, first, last))))
 					rules.insert(m);
 				continue;
 			}
@@ -510,7 +556,7 @@ namespace parse
 
 				apply_captures(scope, m.match, rule->captures, scopes, firstLine);
 
-				if((m.match = regexp::search(m.rule->match_pattern, first, last, first + i, last, anchor_options(firstLine, stack->anchor == i, first, last))))
+				if((m.match = search(m.rule, pattern_kind_t::match, m.rule->match_pattern, first, last, first + i, last, anchor_options(firstLine, stack->anchor == i, first, last))))
 					rules.insert(m);
 
 				continue; // no context change, so skip finding rules for this context
@@ -524,6 +570,8 @@ namespace parse
 
 	stack_ptr parse (char const* first, char const* last, stack_ptr stack, std::map<size_t, scope::scope_t>& map, bool firstLine)
 	{
+		oak::trace::span_t span("parse", "parse");
+
 		scopes_t scopes;
 		if(last - first > kParserMaxLineSize)
 			last = utf8::find_safe_end(first, first + kParserMaxLineSize);
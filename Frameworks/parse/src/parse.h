@@ -12,6 +12,30 @@ namespace parse
 	stack_ptr parse (char const* first, char const* last, stack_ptr stack, std::map<size_t, scope::scope_t>& scopes, bool firstLine);
 	bool equal (stack_ptr lhs, stack_ptr rhs);
 
+	// Statistics about the regular expression searches done by the parser,
+	// collected for the calling thread while a profile is installed.
+	struct profile_t
+	{
+		struct rule_stats_t
+		{
+			std::string scope = NULL_STR;
+			std::string match_string = NULL_STR;
+			std::string end_string = NULL_STR;
+
+			size_t match_tries = 0, match_hits = 0;
+			size_t end_tries = 0, end_hits = 0;
+			size_t while_tries = 0, while_hits = 0;
+			double match_time = 0, end_time = 0, while_time = 0; // seconds
+
+			double total_time () const { return match_time + end_time + while_time; }
+		};
+
+		std::map<size_t, rule_stats_t> rules; // keyed on rule id
+		size_t collect_rules = 0;             // number of times the rules of a context were (re)collected
+	};
+
+	void set_profile (profile_t* profile); // pass nullptr to stop profiling
+
 } /* parse */
 
 #endif /* end of include guard: GRAMMAR_TYPES_H_4M8CRK03 */
@@ -0,0 +1,95 @@
+#include <parse/src/grammar.h>
+#include <parse/src/parse.h>
+#include <test/bundle_index.h>
+#include <test/benchmark.h>
+
+static bundles::item_ptr CLikeGrammarItem;
+
+void setup_fixtures ()
+{
+	static std::string CLikeLanguageGrammar =
+		"{ name           = 'C-like';"
+		"  patterns       = ("
+		"    { include = '#comments'; },"
+		"    { name = 'meta.preprocessor.include'; match = '^\\s*(#)\\s*include\\s+(<[^>]+>|\"[^\"]+\")'; },"
+		"    { name = 'meta.function'; begin = '^(\\w+)\\s+(\\w+)\\s*\\('; end = '\\)';"
+		"      beginCaptures = { 1 = { name = 'storage.type'; }; 2 = { name = 'entity.name.function'; }; };"
+		"      patterns = ( { include = '#expressions'; } );"
+		"    },"
+		"    { name = 'meta.block'; begin = '\\{'; end = '\\}'; patterns = ( { include = '$self'; } ); },"
+		"    { include = '#expressions'; },"
+		"  );"
+		"  repository = {"
+		"    comments = {"
+		"      patterns = ("
+		"        { name = 'comment.line.double-slash'; match = '//.*$\\n?'; },"
+		"        { name = 'comment.block'; begin = '/\\*'; end = '\\*/'; },"
+		"      );"
+		"    };"
+		"    expressions = {"
+		"      patterns = ("
+		"        { include = '#comments'; },"
+		"        { name = 'string.quoted.double'; begin = '\"'; end = '\"'; patterns = ( { name = 'constant.character.escape'; match = '\\\\.'; } ); },"
+		"        { name = 'constant.numeric'; match = '\\b(0x[0-9a-fA-F]+|\\d+(\\.\\d+)?)\\b'; },"
+		"        { name = 'keyword.control'; match = '\\b(if|else|for|while|return|switch|case|break)\\b'; },"
+		"        { name = 'storage.type'; match = '\\b(int|char|void|size_t|bool|struct)\\b'; },"
+		"        { name = 'keyword.operator'; match = '[-+*/%=<>!&|]+'; },"
+		"      );"
+		"    };"
+		"  };"
+		"  scopeName      = 'source.c-like';"
+		"  uuid           = '2F3A1C44-7D2B-4E55-9B0C-6E1A8A4C9D21';"
+		"}";
+
+	test::bundle_index_t bundleIndex;
+	CLikeGrammarItem = bundleIndex.add(bundles::kItemTypeGrammar, CLikeLanguageGrammar);
+}
+
+static std::string corpus ()
+{
+	static std::string const kSource =
+		"#include <stdio.h>\n"
+		"\n"
+		"/* Compute a checksum\n"
+		"   over a buffer. */\n"
+		"int checksum (char const* buf, size_t len)\n"
+		"{\n"
+		"	int res = 0x1505; // djb2\n"
+		"	for(size_t i = 0; i < len; ++i)\n"
+		"	{\n"
+		"		if(buf[i] == '\\n')\n"
+		"			continue;\n"
+		"		res = ((res << 5) + res) + buf[i];\n"
+		"	}\n"
+		"	printf(\"checksum: %d\\n\", res);\n"
+		"	return res;\n"
+		"}\n"
+		"\n";
+
+	std::string res;
+	while(res.size() < 256*1024)
+		res += kSource;
+	return res;
+}
+
+void benchmark_parse_c_like_256_kb ()
+{
+	auto grammar = parse::parse_grammar(CLikeGrammarItem);
+	std::string const buf = corpus();
+
+	test::benchmark("parse.c_like", [&](){
+		size_t scopeChanges = 0;
+		parse::stack_ptr parserState = grammar->seed();
+		for(std::string::size_type i = 0; i != buf.size(); )
+		{
+			auto eol = buf.find('\n', i);
+			eol = eol != std::string::npos ? ++eol : buf.size();
+
+			std::map<size_t, scope::scope_t> scopes;
+			parserState = parse::parse(buf.data() + i, buf.data() + eol, parserState, scopes, i == 0);
+			scopeChanges += scopes.size();
+			i = eol;
+		}
+		OAK_ASSERT(scopeChanges != 0);
+	}, buf.size());
+}
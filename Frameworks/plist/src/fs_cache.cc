@@ -5,6 +5,7 @@
 #include <io/src/entries.h>
 #include <text/src/format.h>
 #include <oak/debug.h>
+#include <oak/trace.h>
 
 static std::string read_link (std::string const& path)
 {
@@ -86,6 +87,8 @@ namespace plist
 
 	void cache_t::load_capnp (std::string const& path)
 	{
+		oak::trace::span_t span("plist", "load_capnp", path);
+
 		try {
 			real_load(path);
 		}
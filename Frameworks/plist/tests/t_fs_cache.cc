@@ -0,0 +1,49 @@
+#include <plist/src/fs_cache.h>
+#include <text/src/format.h>
+#include <test/jail.h>
+#include <test/benchmark.h>
+
+static size_t const kItemCount = 2000;
+
+static std::string populate (test::jail_t& jail)
+{
+	for(size_t i = 0; i < kItemCount; ++i)
+		jail.set_content(text::format("Bundle/Commands/Item %zu.plist", i), text::format("{ name = 'Item %zu'; input = 'selection'; output = 'replaceSelectedText'; command = '#!/bin/sh\necho %zu\n'; }", i, i));
+
+	plist::cache_t cache;
+	for(auto const& path : cache.entries(jail.path("Bundle/Commands")))
+		cache.content(path);
+
+	std::string const cachePath = jail.path("Cache.binary");
+	cache.save_capnp(cachePath);
+	return cachePath;
+}
+
+void test_load_capnp ()
+{
+	test::jail_t jail;
+	std::string const cachePath = populate(jail);
+
+	// Remove the source so content can only come from the loaded cache
+	std::string const itemPath = jail.path("Bundle/Commands/Item 42.plist");
+	jail.remove("Bundle/Commands/Item 42.plist");
+
+	plist::cache_t cache;
+	cache.load_capnp(cachePath);
+	OAK_ASSERT_EQ(cache.entries(jail.path("Bundle/Commands")).size(), kItemCount);
+	std::string name;
+	OAK_ASSERT(plist::get_key_path(cache.content(itemPath), "name", name));
+	OAK_ASSERT_EQ(name, "Item 42");
+}
+
+void benchmark_load_capnp ()
+{
+	test::jail_t jail;
+	std::string const cachePath = populate(jail);
+
+	test::benchmark("plist.cache_load_capnp", [&](){
+		plist::cache_t cache;
+		cache.load_capnp(cachePath);
+		OAK_ASSERT(!cache.dirty());
+	}, path::content(cachePath).size());
+}
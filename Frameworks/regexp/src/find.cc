@@ -1,8 +1,10 @@
 #include "find.h"
+#include "regexp.h"
 #include "private.h"
 #include <Onigmo/oniguruma.h>
 #include <text/src/utf8.h>
 #include <cf/src/cf.h>
+#include <oak/trace.h>
 
 namespace find
 {
@@ -392,7 +394,7 @@ namespace find
 				}
 
 				int r;
-				OnigRegion* region = onig_region_new();
+				OnigRegion* region = regexp::scratch_region();
 				if(ONIG_MISMATCH != (r = onig_search(compiled_pattern, first, last, range_start, range_stop, region, flags)))
 				{
 					// fprintf(stderr, "match: %d-%d\n", region->beg[0], region->end[0]);
@@ -406,8 +408,6 @@ namespace find
 
 				last_beg = region->beg[0];
 				last_end = region->end[0];
-
-				onig_region_free(region, 1);
 			}
 			else
 			{
@@ -447,13 +447,23 @@ namespace find
 
 	void find_t::each_match (char const* buf, size_t len, bool moreToCome, std::function<void(std::pair<size_t, size_t> const&, std::map<std::string, std::string> const&, bool*)> const& f)
 	{
+		each_match(buf, len, moreToCome, true, [&f](std::pair<size_t, size_t> const& match, std::map<std::string, std::string> const* captures, bool* stop){ f(match, *captures, stop); });
+	}
+
+	void find_t::each_match (char const* buf, size_t len, bool moreToCome, bool wantCaptures, std::function<void(std::pair<size_t, size_t> const&, std::map<std::string, std::string> const*, bool*)> const& f)
+	{
+		oak::trace::span_t span("find", "each_match");
+
+		std::map<std::string, std::string> captures;
+		std::map<std::string, std::string>* capturesPtr = wantCaptures ? &captures : nullptr;
+
 		bool stop = false;
 		for(size_t offset = 0; offset < len && !stop; )
 		{
-			std::map<std::string, std::string> captures;
-			std::pair<ssize_t, ssize_t> const& m = pimpl->match(buf + offset, len - offset, &captures);
+			captures.clear();
+			std::pair<ssize_t, ssize_t> const& m = pimpl->match(buf + offset, len - offset, capturesPtr);
 			if(m.first <= m.second)
-				f(std::make_pair(_offset + offset + m.first, _offset + offset + m.second), captures, &stop);
+				f(std::make_pair(_offset + offset + m.first, _offset + offset + m.second), capturesPtr, &stop);
 			offset += m.second;
 		}
 
@@ -461,13 +471,13 @@ namespace find
 
 		if(!moreToCome) // Reached end-of-buffer
 		{
-			std::map<std::string, std::string> captures;
-			std::pair<ssize_t, ssize_t> m = pimpl->match(nullptr, 0, &captures);
+			captures.clear();
+			std::pair<ssize_t, ssize_t> m = pimpl->match(nullptr, 0, capturesPtr);
 			while(m.first <= m.second && !stop)
 			{
-				f(std::make_pair(_offset + m.first, _offset + m.second), captures, &stop);
+				f(std::make_pair(_offset + m.first, _offset + m.second), capturesPtr, &stop);
 				captures.clear();
-				m = pimpl->match(nullptr, 0, &captures);
+				m = pimpl->match(nullptr, 0, capturesPtr);
 			}
 		}
 	}
@@ -36,6 +36,9 @@ namespace find
 		void each_match (char const* buf, size_t len, bool moreToCome, std::function<void(std::pair<size_t, size_t> const&, std::map<std::string, std::string> const&)> const& f);
 		void each_match (char const* buf, size_t len, bool moreToCome, std::function<void(std::pair<size_t, size_t> const&, std::map<std::string, std::string> const&, bool*)> const& f);
 
+		// Captures are only extracted when wantCaptures is set, otherwise the callback receives nullptr
+		void each_match (char const* buf, size_t len, bool moreToCome, bool wantCaptures, std::function<void(std::pair<size_t, size_t> const&, std::map<std::string, std::string> const*, bool*)> const& f);
+
 	private:
 		std::shared_ptr<find_implementation_t> pimpl;
 		size_t _offset = 0;
@@ -3,6 +3,7 @@
 
 #include <oak/oak.h>
 #include <text/src/format.h>
+#include <list>
 
 namespace regexp
 {
@@ -21,33 +22,121 @@ namespace regexp
 		return ptrn;
 	}
 
-	// =============
-	// = pattern_t =
-	// =============
+	// =================
+	// = Pattern Cache =
+	// =================
 
-	void pattern_t::init (std::string const& pattern, OnigOptionType options)
+	static regex_ptr compile (std::string const& pattern, OnigOptionType options)
 	{
 		OnigRegex tmp = nullptr;
 
 		OnigErrorInfo einfo;
-		if((options & ONIG_OPTION_DONT_CAPTURE_GROUP) == 0)
-			options |= ONIG_OPTION_CAPTURE_GROUP;
 		int r = onig_new(&tmp, (OnigUChar const*)pattern.data(), (OnigUChar const*)pattern.data() + pattern.size(), options, ONIG_ENCODING_UTF8, ONIG_SYNTAX_DEFAULT, &einfo);
 		if(r == ONIG_NORMAL)
+			return regex_ptr(tmp, onig_free);
+
+		OnigUChar s[ONIG_MAX_ERROR_MESSAGE_LEN];
+		onig_error_code_to_str(s, r, &einfo);
+		os_log_error(OS_LOG_DEFAULT, "pattern_t: %{public}s (%{public}s)", s, pattern.c_str());
+
+		if(tmp)
+			onig_free(tmp);
+		return regex_ptr();
+	}
+
+	namespace
+	{
+		struct pattern_cache_t
 		{
-			compiled_pattern.reset(tmp, onig_free);
-		}
-		else
-		{
-			OnigUChar s[ONIG_MAX_ERROR_MESSAGE_LEN];
-			onig_error_code_to_str(s, r, &einfo);
-			os_log_error(OS_LOG_DEFAULT, "pattern_t: %{public}s (%{public}s)", s, pattern.c_str());
+			regex_ptr get (std::string const& pattern, OnigOptionType options)
+			{
+				key_t const key(pattern, options);
+
+				std::unique_lock<std::mutex> lock(_mutex);
+				auto it = _map.find(key);
+				if(it != _map.end())
+				{
+					++_hits;
+					_lru.splice(_lru.begin(), _lru, it->second);
+					return it->second->second;
+				}
+				++_misses;
+				lock.unlock();
+
+				regex_ptr res = compile(pattern, options); // failures are cached too so we only report them once
 
-			if(tmp)
-				onig_free(tmp);
+				lock.lock();
+				it = _map.find(key);
+				if(it != _map.end()) // another thread compiled it meanwhile
+					return it->second->second;
+
+				_lru.emplace_front(key, res);
+				_map.emplace(key, _lru.begin());
+				shrink();
+				return res;
+			}
+
+			pattern_cache_stats_t stats ()
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				return { _hits, _misses, _map.size(), _capacity };
+			}
+
+			void set_capacity (size_t capacity)
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_capacity = capacity;
+				shrink();
+			}
+
+		private:
+			typedef std::pair<std::string, OnigOptionType> key_t;
+			typedef std::list<std::pair<key_t, regex_ptr>> lru_t;
+
+			void shrink ()
+			{
+				while(_map.size() > _capacity)
+				{
+					_map.erase(_lru.back().first);
+					_lru.pop_back();
+				}
+			}
+
+			std::mutex _mutex;
+			lru_t _lru;
+			std::map<key_t, lru_t::iterator> _map;
+			size_t _capacity = 1024;
+			size_t _hits = 0, _misses = 0;
+		};
+
+		pattern_cache_t& pattern_cache ()
+		{
+			static pattern_cache_t* cache = new pattern_cache_t;
+			return *cache;
 		}
 	}
 
+	pattern_cache_stats_t pattern_cache_stats ()
+	{
+		return pattern_cache().stats();
+	}
+
+	void set_pattern_cache_capacity (size_t capacity)
+	{
+		pattern_cache().set_capacity(capacity);
+	}
+
+	// =============
+	// = pattern_t =
+	// =============
+
+	void pattern_t::init (std::string const& pattern, OnigOptionType options)
+	{
+		if((options & ONIG_OPTION_DONT_CAPTURE_GROUP) == 0)
+			options |= ONIG_OPTION_CAPTURE_GROUP;
+		compiled_pattern = pattern_cache().get(pattern, options);
+	}
+
 	pattern_t::pattern_t (char const* pattern, OnigOptionType options) : pattern_string(pattern)
 	{
 		init(pattern, options);
@@ -75,10 +164,41 @@ namespace regexp
 		init(pattern, options);
 	}
 
+	// ================
+	// = match_view_t =
+	// ================
+
+	std::map<std::string, std::string> match_view_t::captures () const
+	{
+		return did_match() ? extract_captures((OnigUChar const*)buffer(), region, pattern->compiled_pattern.get()) : std::map<std::string, std::string>();
+	}
+
+	std::string match_view_t::operator[] (size_t i) const
+	{
+		return did_match(i) ? std::string(buffer() + begin(i), buffer() + end(i)) : NULL_STR;
+	}
+
 	// ===========
 	// = match_t =
 	// ===========
 
+	static region_ptr copy_region (OnigRegion const* region)
+	{
+		struct helper_t { static void region_free (OnigRegion* r) { onig_region_free(r, 1); } };
+		region_ptr res(onig_region_new(), &helper_t::region_free);
+		onig_region_copy(res.get(), const_cast<OnigRegion*>(region));
+		return res;
+	}
+
+	match_t::match_t (match_view_t const& view) : buf(view.buf)
+	{
+		if(view.did_match())
+		{
+			region           = copy_region(view.region);
+			compiled_pattern = view.pattern->get();
+		}
+	}
+
 	std::map<std::string, std::string> const& match_t::captures () const
 	{
 		if(!captured_variables)
@@ -124,19 +244,40 @@ namespace regexp
 	// = Matching =
 	// ============
 
-	match_t search (pattern_t const& ptrn, char const* first, char const* last, char const* from, char const* to, OnigOptionType options)
+	OnigRegion* scratch_region ()
 	{
-		if(ptrn)
+		struct region_t
 		{
-			char const* gpos = (options & ONIG_OPTION_NOTGPOS) ? nullptr : (from ?: first);
-			options &= ~ONIG_OPTION_NOTGPOS;
+			region_t ()  { onig_region_init(&region); }
+			~region_t () { onig_region_free(&region, 0); }
+			OnigRegion region;
+		};
 
-			struct helper_t { static void region_free (OnigRegion* r) { onig_region_free(r, 1); } };
-			regexp::region_ptr region(onig_region_new(), &helper_t::region_free);
-			if(ONIG_MISMATCH != onig_search_gpos(ptrn.get().get(), (OnigUChar const*)first, (OnigUChar const*)last, (OnigUChar*)gpos, (OnigUChar const*)(from ?: first), (OnigUChar const*)(to ?: last), region.get(), options))
-				return match_t(region, ptrn.get(), first);
-		}
-		return match_t();
+		thread_local region_t res;
+		return &res.region;
+	}
+
+	bool search (pattern_t const& ptrn, char const* first, char const* last, char const* from, char const* to, OnigOptionType options, OnigRegion* region)
+	{
+		if(!ptrn)
+			return false;
+
+		char const* gpos = (options & ONIG_OPTION_NOTGPOS) ? nullptr : (from ?: first);
+		options &= ~ONIG_OPTION_NOTGPOS;
+		return ONIG_MISMATCH != onig_search_gpos(ptrn.compiled_pattern.get(), (OnigUChar const*)first, (OnigUChar const*)last, (OnigUChar*)gpos, (OnigUChar const*)(from ?: first), (OnigUChar const*)(to ?: last), region, options);
+	}
+
+	match_view_t search_view (pattern_t const& ptrn, char const* first, char const* last, char const* from, char const* to, OnigOptionType options)
+	{
+		OnigRegion* region = scratch_region();
+		if(search(ptrn, first, last, from, to, options, region))
+			return match_view_t(region, &ptrn, first);
+		return match_view_t();
+	}
+
+	match_t search (pattern_t const& ptrn, char const* first, char const* last, char const* from, char const* to, OnigOptionType options)
+	{
+		return match_t(search_view(ptrn, first, last, from, to, options));
 	}
 
 	match_t search (pattern_t const& ptrn, std::string const& str)
@@ -11,8 +11,39 @@ namespace regexp
 	typedef std::shared_ptr<OnigRegion> region_ptr;
 
 	struct match_t;
+	struct match_view_t;
 	struct pattern_t;
 
+	// Non-owning view of a match, only valid until the region it refers to is reused
+	struct match_view_t
+	{
+		match_view_t () { }
+		match_view_t (OnigRegion const* region, pattern_t const* pattern, char const* buf) : region(region), pattern(pattern), buf(buf) { }
+
+		int size () const                { return region ? region->num_regs : 0; }
+		bool empty (int i = 0) const     { return begin(i) == end(i); }
+
+		bool did_match (int i = 0) const { return i < size() && region->beg[i] != -1; }
+
+		explicit operator bool () const  { return did_match(); }
+
+		char const* buffer () const      { return buf; }
+
+		size_t begin () const            { return did_match() ? (size_t)region->beg[0] : SIZE_T_MAX; }
+		size_t end () const              { return did_match() ? (size_t)region->end[0] : SIZE_T_MAX; }
+		size_t begin (int i) const       { return did_match(i) ? (size_t)region->beg[i] : end(); }
+		size_t end (int i) const         { return did_match(i) ? (size_t)region->end[i] : end(); }
+
+		std::map<std::string, std::string> captures () const;
+		std::string operator[] (size_t i) const;
+
+	private:
+		friend struct match_t;
+		OnigRegion const* region = nullptr;
+		pattern_t const* pattern = nullptr;
+		char const* buf = nullptr;
+	};
+
 	struct match_t
 	{
 	private:
@@ -23,11 +54,9 @@ namespace regexp
 		mutable std::shared_ptr< std::map<std::string, std::string> > captured_variables;
 		mutable std::shared_ptr< std::multimap<std::string, std::pair<size_t, size_t> > > captured_indices;
 
-		friend match_t search (pattern_t const& ptrn, char const* first, char const* last, char const* from, char const* to, OnigOptionType options);
-		match_t (region_ptr const& region, regex_ptr const& compiled_pattern, char const* buf) : region(region), compiled_pattern(compiled_pattern), buf(buf) { }
-
 	public:
 		match_t () : buf(NULL) { }
+		match_t (match_view_t const& view);
 
 		int size () const                { return region ? region->num_regs : 0; }
 		bool empty (int i = 0) const     { return begin(i) == end(i); }
@@ -55,7 +84,9 @@ namespace regexp
 		std::string pattern_string;
 		void init (std::string const& pattern, OnigOptionType options);
 
-		friend match_t search (pattern_t const& ptrn, char const* first, char const* last, char const* from, char const* to, OnigOptionType options);
+		friend bool search (pattern_t const& ptrn, char const* first, char const* last, char const* from, char const* to, OnigOptionType options, OnigRegion* region);
+		friend struct match_view_t;
+		friend struct match_t;
 		regex_ptr get () const { return compiled_pattern; }
 	public:
 		pattern_t () : pattern_string("(?=un)initialized") { }
@@ -72,11 +103,29 @@ namespace regexp
 
 	inline std::string to_s (pattern_t const& ptrn) { return ptrn.pattern_string; }
 
+	// Compiled patterns are shared process wide, keyed by pattern and options
+	struct pattern_cache_stats_t
+	{
+		size_t hits;
+		size_t misses;
+		size_t size;
+		size_t capacity;
+	};
+
+	pattern_cache_stats_t pattern_cache_stats ();
+	void set_pattern_cache_capacity (size_t capacity);
+
 	std::string validate (std::string const& ptrn);
 	std::string escape (std::string ptrn);
 	match_t search (pattern_t const& ptrn, char const* first, char const* last, char const* from = NULL, char const* to = NULL, OnigOptionType options = ONIG_OPTION_NONE);
 	match_t search (pattern_t const& ptrn, std::string const& str);
 
+	// Allocation free matching: results are written to a caller owned region
+	// or the calling thread’s scratch region (invalidated by the next search).
+	OnigRegion* scratch_region ();
+	bool search (pattern_t const& ptrn, char const* first, char const* last, char const* from, char const* to, OnigOptionType options, OnigRegion* region);
+	match_view_t search_view (pattern_t const& ptrn, char const* first, char const* last, char const* from = NULL, char const* to = NULL, OnigOptionType options = ONIG_OPTION_NONE);
+
 } /* regexp */
 
 #endif /* end of include guard: ONIG_REGEXP_H_UMTUKY6I */
@@ -1,4 +1,5 @@
 #include <regexp/src/find.h>
+#include <test/benchmark.h>
 
 typedef std::pair<size_t, size_t> range_t;
 
@@ -29,3 +30,28 @@ void test_regexp_backward ()
 	OAK_ASSERT_EQ(ranges.size(), 1);
 	OAK_ASSERT_EQ(ranges[0], range_t(6, 17));
 }
+
+static std::string benchmark_text ()
+{
+	std::string const line = "\tif(matcher.each_match(text.data(), text.size(), false) != range_t(0, 6))\n";
+	std::string res;
+	while(res.size() < 1024*1024)
+		res += line;
+	return res;
+}
+
+void benchmark_find_literal ()
+{
+	std::string const text = benchmark_text();
+	test::benchmark("find.literal", [&](){
+		OAK_ASSERT(!all_matches(find::find_t("each_match"), text).empty());
+	}, text.size());
+}
+
+void benchmark_find_regexp ()
+{
+	std::string const text = benchmark_text();
+	test::benchmark("find.regexp", [&](){
+		OAK_ASSERT(!all_matches(find::find_t("range_t\\(\\d+, \\d+\\)", find::regular_expression), text).empty());
+	}, text.size());
+}
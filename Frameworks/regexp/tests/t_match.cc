@@ -9,3 +9,44 @@ void test_match ()
 	OAK_ASSERT_EQ(match[2], "bar");
 	OAK_ASSERT_EQ(match[3], NULL_STR);
 }
+
+void test_match_view ()
+{
+	regexp::pattern_t const ptrn("(?<first>\\w+)\\s+(\\w+)");
+	std::string const str = " foo bar fud";
+
+	regexp::match_view_t const view = regexp::search_view(ptrn, str.data(), str.data() + str.size());
+	OAK_ASSERT(view);
+	OAK_ASSERT_EQ(view.begin(), 1);
+	OAK_ASSERT_EQ(view.end(), 8);
+	OAK_ASSERT_EQ(view[2], "bar");
+	OAK_ASSERT_EQ(view.captures().at("first"), "foo");
+
+	regexp::match_t const match = view;
+	std::string const other = "baz";
+	OAK_ASSERT(!regexp::search_view(ptrn, other.data(), other.data() + other.size()));
+	OAK_ASSERT_EQ(match[0], "foo bar");
+	OAK_ASSERT_EQ(match.captures().at("first"), "foo");
+
+	OnigRegion* region = onig_region_new();
+	OAK_ASSERT(regexp::search(ptrn, str.data(), str.data() + str.size(), str.data() + 5, str.data() + str.size(), ONIG_OPTION_NONE, region));
+	OAK_ASSERT_EQ(region->beg[0], 5);
+	OAK_ASSERT_EQ(region->end[0], 12);
+	onig_region_free(region, 1);
+}
+
+void test_pattern_cache ()
+{
+	regexp::pattern_cache_stats_t const before = regexp::pattern_cache_stats();
+	regexp::pattern_t const ptrn1("^HEREDOC_T_MATCH$");
+	regexp::pattern_t const ptrn2("^HEREDOC_T_MATCH$");
+	regexp::pattern_t const ptrn3("^HEREDOC_T_MATCH$", ONIG_OPTION_IGNORECASE);
+	regexp::pattern_cache_stats_t const after = regexp::pattern_cache_stats();
+
+	OAK_ASSERT_EQ(after.misses - before.misses, 2);
+	OAK_ASSERT_EQ(after.hits - before.hits, 1);
+	OAK_ASSERT(ptrn1 && ptrn2 && ptrn3);
+	OAK_ASSERT(regexp::search(ptrn2, "HEREDOC_T_MATCH"));
+	OAK_ASSERT(!regexp::search(ptrn2, "heredoc_t_match"));
+	OAK_ASSERT(regexp::search(ptrn3, "heredoc_t_match"));
+}
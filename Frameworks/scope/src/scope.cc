@@ -198,21 +198,21 @@ namespace scope
 
 	std::string xml_difference (scope_t const& from, scope_t const& to, std::string const& open, std::string const& close)
 	{
-		std::vector<std::string> fromScopes, toScopes;
-		for(scope_t tmp = from; !tmp.empty(); tmp.pop_scope())
-			fromScopes.push_back(tmp.back());
-		for(scope_t tmp = to; !tmp.empty(); tmp.pop_scope())
-			toScopes.push_back(tmp.back());
-
-		auto fromIter = fromScopes.rbegin(), toIter = toScopes.rbegin();
-		while(fromIter != fromScopes.rend() && toIter != toScopes.rend() && *fromIter == *toIter)
+		std::vector<scope_t::node_t const*> fromNodes, toNodes;
+		for(auto n = from.node; n; n = n->parent())
+			fromNodes.push_back(n);
+		for(auto n = to.node; n; n = n->parent())
+			toNodes.push_back(n);
+
+		auto fromIter = fromNodes.rbegin(), toIter = toNodes.rbegin();
+		while(fromIter != fromNodes.rend() && toIter != toNodes.rend() && (*fromIter == *toIter || (*fromIter)->_atoms == (*toIter)->_atoms))
 			++fromIter, ++toIter;
 
 		std::string res = "";
-		for(auto it = fromScopes.begin(); it != fromIter.base(); ++it)
-			res += open + "/" + *it + close;
-		for(auto it = toIter; it != toScopes.rend(); ++it)
-			res += open + *it + close;
+		for(auto it = fromNodes.begin(); it != fromIter.base(); ++it)
+			res.append(open).append("/").append((*it)->_atoms).append(close);
+		for(auto it = toIter; it != toNodes.rend(); ++it)
+			res.append(open).append((*it)->_atoms).append(close);
 		return res;
 	}
 
@@ -58,6 +58,7 @@ namespace scope
 		private:
 			friend scope_t;
 			friend scope_t shared_prefix (scope_t const& lhs, scope_t const& rhs);
+			friend std::string xml_difference (scope_t const& from, scope_t const& to, std::string const& open, std::string const& close);
 			std::string _atoms;
 			node_t* _parent;
 			std::atomic_size_t _retain_count;
@@ -69,6 +70,7 @@ namespace scope
 		void to_s_helper (scope_t::node_t* n, std::string& out) const;
 		friend struct scope::types::path_t;
 		friend scope_t shared_prefix (scope_t const& lhs, scope_t const& rhs);
+		friend std::string xml_difference (scope_t const& from, scope_t const& to, std::string const& open, std::string const& close);
 		node_t* node = nullptr;
 	};
 
@@ -0,0 +1,69 @@
+#include "xml_writer.h"
+
+namespace scope
+{
+	// Sets the high bit of each byte in ‘word’ equal to ‘byte’. Bits above a match may also be set, so this is only used to test if there is a match
+	static inline uint64_t match_byte (uint64_t word, uint8_t byte)
+	{
+		uint64_t const x = word ^ (0x0101010101010101ULL * byte);
+		return (x - 0x0101010101010101ULL) & ~x & 0x8080808080808080ULL;
+	}
+
+	char const* find_xml_special (char const* first, char const* last, bool escapeGreaterThan)
+	{
+		// Skip 8 bytes at a time while none of them need escaping
+		for(uint64_t word; last - first >= 8; first += 8)
+		{
+			memcpy(&word, first, sizeof(word));
+			if(match_byte(word, '<') | match_byte(word, '&') | (escapeGreaterThan ? match_byte(word, '>') : 0))
+				break;
+		}
+
+		while(first != last && *first != '<' && *first != '&' && (!escapeGreaterThan || *first != '>'))
+			++first;
+		return first;
+	}
+
+	xml_writer_t::xml_writer_t (sink_t const& sink, scope_t const& scope, bool escapeGreaterThan) : _sink(sink), _scope(scope), _escape_greater_than(escapeGreaterThan)
+	{
+		_tags.set_empty_key(std::make_pair(scope_t(), scope_t())); // never looked up, set_scope() returns early for equal scopes
+	}
+
+	bool xml_writer_t::text (char const* first, char const* last)
+	{
+		while(first != last)
+		{
+			char const* it = find_xml_special(first, last, _escape_greater_than);
+			if(first != it && !_sink(first, it - first))
+				return false;
+			if(it == last)
+				break;
+
+			bool const res = *it == '<' ? _sink("&lt;", 4) : (*it == '&' ? _sink("&amp;", 5) : _sink("&gt;", 4));
+			if(!res)
+				return false;
+			first = it + 1;
+		}
+		return true;
+	}
+
+	bool xml_writer_t::set_scope (scope_t const& scope)
+	{
+		static size_t const kMaxCachedTags = 4096;
+		if(scope == _scope)
+			return true;
+
+		auto key = std::make_pair(_scope, scope);
+		auto it = _tags.find(key);
+		if(it == _tags.end())
+		{
+			if(_tags.size() == kMaxCachedTags)
+				_tags.clear();
+			it = _tags.insert(std::make_pair(key, xml_difference(_scope, scope, "<", ">"))).first;
+		}
+
+		_scope = scope;
+		return it->second.empty() || _sink(it->second.data(), it->second.size());
+	}
+
+} /* scope */
@@ -0,0 +1,41 @@
+#ifndef SCOPE_XML_WRITER_H_4TQ9WD2B
+#define SCOPE_XML_WRITER_H_4TQ9WD2B
+
+#include "scope.h"
+
+namespace scope
+{
+	// Writes scoped text as XML, e.g. ‘<source.c><comment.line>// x</comment.line></source.c>’.
+	//
+	// Output is handed to ‘sink’ in pieces and writing stops once it returns
+	// false. Tags are computed once per pair of scopes, so the transitions
+	// repeated on most lines of a document are only a lookup, which is cheap
+	// when scopes share nodes (as they do when coming from a buffer).
+
+	struct xml_writer_t
+	{
+		typedef std::function<bool(char const*, size_t)> sink_t;
+
+		xml_writer_t (sink_t const& sink, scope_t const& scope = scope_t(), bool escapeGreaterThan = false);
+
+		bool text (char const* first, char const* last);
+		bool set_scope (scope_t const& scope);
+
+	private:
+		struct hash_t
+		{
+			size_t operator() (std::pair<scope_t, scope_t> const& key) const { return key.first.hash() * 31 + key.second.hash(); }
+		};
+
+		sink_t _sink;
+		scope_t _scope;
+		bool _escape_greater_than;
+		google::dense_hash_map<std::pair<scope_t, scope_t>, std::string, hash_t> _tags;
+	};
+
+	// Returns the first ‘<’ or ‘&’ (or ‘>’ when ‘escapeGreaterThan’ is set) in [first, last) or ‘last’ if there is none
+	char const* find_xml_special (char const* first, char const* last, bool escapeGreaterThan = false);
+
+} /* scope */
+
+#endif /* end of include guard: SCOPE_XML_WRITER_H_4TQ9WD2B */
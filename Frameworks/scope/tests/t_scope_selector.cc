@@ -1,4 +1,5 @@
 #include <scope/src/scope.h>
+#include <test/benchmark.h>
 
 void test_child_selector ()
 {
@@ -134,3 +135,21 @@ void test_match ()
 	OAK_ASSERT( match("foo > bar > baz $",     "foo bar baz foo bar baz"));
 	OAK_ASSERT(!match("^ foo > bar > baz $",   "foo bar baz foo bar baz"));
 }
+
+void benchmark_selector_does_match ()
+{
+	scope::scope_t const scope("text.html.markdown meta.paragraph.markdown markup.bold.markdown punctuation.definition.bold.markdown");
+	std::vector<scope::selector_t> const selectors = {
+		"text.html.markdown", "markup.bold", "source.ruby string.quoted", "text.html - source", "meta.paragraph > markup.bold", "(text | source) & punctuation", "L:text.html.markdown markup.bold, R:source"
+	};
+
+	test::benchmark("scope.selector_does_match", [&](){
+		size_t matches = 0;
+		for(size_t i = 0; i < 1000; ++i)
+		{
+			for(auto const& selector : selectors)
+				matches += selector.does_match(scope) ? 1 : 0;
+		}
+		OAK_ASSERT(matches != 0);
+	});
+}
@@ -1,4 +1,5 @@
 #include <scope/src/scope.h>
+#include <scope/src/xml_writer.h>
 
 void test_shared_prefix ()
 {
@@ -20,3 +21,27 @@ void test_xml_difference ()
 	OAK_ASSERT_EQ("</foo><baz><qux>", xml_difference(second, third));
 	OAK_ASSERT_EQ("</qux></baz>",     xml_difference(third, empty));
 }
+
+void test_xml_writer ()
+{
+	std::string res;
+	scope::xml_writer_t writer([&res](char const* data, size_t len){ res.append(data, len); return true; });
+
+	std::string const text = "if(a < b && c > d)";
+	writer.set_scope("source.c");
+	writer.text(text.data(), text.data() + 3);
+	writer.set_scope("source.c meta.condition");
+	writer.text(text.data() + 3, text.data() + text.size());
+	writer.set_scope("source.c");
+	writer.set_scope(scope::scope_t());
+
+	OAK_ASSERT_EQ(res, "<source.c>if(<meta.condition>a &lt; b &amp;&amp; c > d)</meta.condition></source.c>");
+}
+
+void test_find_xml_special ()
+{
+	std::string const str = "0123456789abcdef0123456789abcdef>0123456789&";
+	OAK_ASSERT_EQ(scope::find_xml_special(str.data(), str.data() + str.size()) - str.data(), 43);
+	OAK_ASSERT_EQ(scope::find_xml_special(str.data(), str.data() + str.size(), true) - str.data(), 32);
+	OAK_ASSERT_EQ(scope::find_xml_special(str.data(), str.data() + 32, true) - str.data(), 32);
+}
@@ -1292,27 +1292,35 @@ namespace ng
 		return ranges.empty();
 	}
 
-	std::map< range_t, std::map<std::string, std::string> > find_all (buffer_api_t const& buffer, std::string const& searchFor, find::options_t options, ranges_t const& searchRanges)
+	bool each_match (buffer_api_t const& buffer, std::string const& searchFor, find::options_t options, ranges_t const& searchRanges, bool wantCaptures, std::function<void(range_t const&, std::map<std::string, std::string> const*, bool*)> const& f)
 	{
-		std::map< range_t, std::map<std::string, std::string> > res;
 		if(searchFor == NULL_STR || searchFor == "")
-			return res;
-
-		ranges_t ranges = dissect_columnar(buffer, searchRanges);
-		find::find_t f(searchFor, (find::options_t)(options & ~find::backwards));
+			return false;
 
-		std::map< range_t, std::map<std::string, std::string> >* tmp = new std::map< range_t, std::map<std::string, std::string> >();
+		ranges_t const ranges = dissect_columnar(buffer, searchRanges);
+		find::find_t finder(searchFor, (find::options_t)(options & ~find::backwards));
 
-		buffer.visit_data([&](char const* buf, size_t offset, size_t len, bool*){
-			f.each_match(buf, len, offset + len < buffer.size(), [&tmp, &ranges](std::pair<size_t, size_t> const& m, std::map<std::string, std::string> const& captures){
+		bool didStop = false;
+		size_t const bufferSize = buffer.size();
+		buffer.visit_data([&](char const* buf, size_t offset, size_t len, bool* stop){
+			finder.each_match(buf, len, offset + len < bufferSize, wantCaptures, [&](std::pair<size_t, size_t> const& m, std::map<std::string, std::string> const* captures, bool* stopMatching){
 				range_t r(m.first, m.second, false, false, true);
 				if(is_subset(r, ranges))
-					tmp->emplace(r, captures);
+					f(r, captures, stopMatching);
+				didStop = *stop = *stopMatching;
 			});
 		});
+		return didStop;
+	}
+
+	std::map< range_t, std::map<std::string, std::string> > find_all (buffer_api_t const& buffer, std::string const& searchFor, find::options_t options, ranges_t const& searchRanges)
+	{
+		static std::map<std::string, std::string> const kNoCaptures;
 
-		res.swap(*tmp);
-		delete tmp;
+		std::map< range_t, std::map<std::string, std::string> > res;
+		each_match(buffer, searchFor, options, searchRanges, options & find::regular_expression, [&res](range_t const& r, std::map<std::string, std::string> const* captures, bool*){
+			res.emplace_hint(res.end(), r, captures ? *captures : kNoCaptures);
+		});
 		return res;
 	}
 
@@ -1327,8 +1335,24 @@ namespace ng
 		if(options & find::ignore_case)
 			ptrnOptions |= ONIG_OPTION_IGNORECASE;
 
-		std::string str = buffer.substr(0, buffer.size());
-		if(regexp::match_t m = search(regexp::pattern_t(searchFor, ptrnOptions), str.data(), str.data() + str.size(), str.data() + first, str.data() + last))
+		// Onigmo needs contiguous memory: when the buffer is stored as a single chunk (e.g. freshly loaded) we search it in place, otherwise we flatten it once
+		char const* data = "";
+		size_t chunks = 0;
+		buffer.visit_data([&](char const* buf, size_t offset, size_t len, bool* stop){
+			data = buf;
+			*stop = ++chunks > 1;
+		});
+
+		std::string flattened;
+		if(chunks > 1)
+		{
+			flattened = buffer.substr(0, buffer.size());
+			data = flattened.data();
+		}
+
+		size_t const size = buffer.size();
+		regexp::pattern_t const ptrn(searchFor, ptrnOptions);
+		if(regexp::match_t m = search(ptrn, data, data + size, data + first, data + last))
 		{
 			if(range.sorted() == ng::range_t(m.begin(), m.end()))
 			{
@@ -1339,10 +1363,10 @@ namespace ng
 				}
 				else
 				{
-					if(first < str.size())
+					if(first < size)
 						first += buffer[first].size();
 				}
-				m = search(regexp::pattern_t(searchFor, ptrnOptions), str.data(), str.data() + str.size(), str.data() + first, str.data() + last);
+				m = search(ptrn, data, data + size, data + first, data + last);
 			}
 
 			if(m && range.sorted() != ng::range_t(m.begin(), m.end()))
@@ -41,6 +41,7 @@ namespace ng
 	ranges_t highlight_ranges_for_movement (buffer_api_t const& buffer, ranges_t const& oldSelection, ranges_t const& newSelection);
 	std::map< range_t, std::map<std::string, std::string> > find (buffer_api_t const& buffer, ranges_t const& selection, std::string const& searchFor, find::options_t options, ranges_t const& searchRanges = ranges_t(), bool* didWrap = nullptr);
 	std::map< range_t, std::map<std::string, std::string> > find_all (buffer_api_t const& buffer, std::string const& searchFor, find::options_t options, ranges_t const& searchRanges = ranges_t());
+	bool each_match (buffer_api_t const& buffer, std::string const& searchFor, find::options_t options, ranges_t const& searchRanges, bool wantCaptures, std::function<void(range_t const&, std::map<std::string, std::string> const*, bool*)> const& f);
 	range_t word_at (buffer_api_t const& buffer, range_t const& range);
 	ranges_t all_words (buffer_api_t const& buffer);
 
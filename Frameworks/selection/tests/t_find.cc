@@ -233,3 +233,27 @@ void test_find_regexp ()
 	OAK_ASSERT_EQ(matches("test",  "(?=.)", kRegExp),   "1&1:2&1:3&1:4");
 	OAK_ASSERT_EQ(matches("test", "(?<=.)", kRegExp), "1:2&1:3&1:4&1:5");
 }
+
+void test_each_match ()
+{
+	ng::buffer_t buffer("foo bar foo bar foo");
+
+	std::vector<ng::range_t> found;
+	bool didStop = ng::each_match(buffer, "foo", find::none, ng::ranges_t(), false, [&found](ng::range_t const& r, std::map<std::string, std::string> const* captures, bool* stop){
+		OAK_ASSERT(captures == nullptr);
+		found.push_back(r);
+		*stop = found.size() == 2;
+	});
+
+	OAK_ASSERT(didStop);
+	OAK_ASSERT_EQ(found.size(), 2);
+	OAK_ASSERT_EQ(to_s(buffer, found.back()), "1:9-1:12");
+
+	std::vector<std::string> captured;
+	ng::each_match(buffer, "b(a)r", find::regular_expression, ng::ranges_t(), true, [&captured](ng::range_t const& r, std::map<std::string, std::string> const* captures, bool*){
+		OAK_ASSERT(captures != nullptr);
+		captured.push_back(captures->at("1"));
+	});
+	OAK_ASSERT_EQ(captured.size(), 2);
+	OAK_ASSERT_EQ(captured.front(), "a");
+}
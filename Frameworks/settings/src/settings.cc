@@ -137,10 +137,18 @@ namespace
 		return res;
 	}
 
-	static std::vector<section_t> const& sections (std::string const& path)
+	typedef std::shared_ptr<std::vector<section_t> const> sections_ptr;
+
+	static size_t& sections_generation () // incremented when a file is (re)parsed or the cache is flushed
+	{
+		static size_t res = 0;
+		return res;
+	}
+
+	static sections_ptr sections (std::string const& path)
 	{
 		static track_paths_t tracked_paths;
-		static std::map<std::string, std::vector<section_t> > cache;
+		static std::map<std::string, sections_ptr> cache;
 
 		if(path == NULL_STR)
 		{
@@ -149,15 +157,19 @@ namespace
 				for(auto const& pair : cache)
 					tracked_paths.remove(pair.first);
 				cache.clear();
+				++sections_generation();
 			}
 
-			static std::vector<section_t> dummy;
+			static sections_ptr dummy = std::make_shared<std::vector<section_t> const>();
 			return dummy;
 		}
 		else
 		{
 			if(tracked_paths.is_changed(path))
-				cache[path] = parse_sections(path);
+			{
+				cache[path] = std::make_shared<std::vector<section_t> const>(parse_sections(path));
+				++sections_generation();
+			}
 			return cache[path];
 		}
 	}
@@ -188,14 +200,23 @@ namespace
 		}
 	}
 
-	static void collect (std::string const& directory, std::string const& path, scope::scope_t const& scope, std::function<void(section_t::assignment_t const& assignment, section_t const& section)> filter)
+	// Assignments that apply to a (directory, path, scope) in the order they should be applied. The sections they point to are kept alive by ‘files’
+	struct collected_t
 	{
-		static std::mutex mutex;
-		std::lock_guard<std::mutex> lock(mutex);
-		sections(NULL_STR); // clear cache if too big
+		size_t generation;
+		std::vector<sections_ptr> files;
+		std::vector<std::pair<section_t::assignment_t const*, section_t const*>> assignments;
+	};
 
-		auto const globalSections  = sections(global_settings_path());
-		auto const defaultSections = sections(default_settings_path());
+	static collected_t collect_assignments (std::string const& directory, std::string const& path, scope::scope_t const& scope, std::vector<sections_ptr> const& files)
+	{
+		collected_t res = { sections_generation(), files };
+		auto filter = [&res](section_t::assignment_t const& assignment, section_t const& section){
+			res.assignments.emplace_back(&assignment, &section);
+		};
+
+		auto const& defaultSections = *files[0];
+		auto const& globalSections  = *files[1];
 
 		std::multimap<double, section_t const*> orderScopeMatches;
 		extract(directory, path, scope, orderScopeMatches, filter, defaultSections, kUnscoped|kScopeSelector);
@@ -209,9 +230,9 @@ namespace
 		extract(directory, path, scope, orderScopeMatches, filter, defaultSections, kGlob);
 		extract(directory, path, scope, orderScopeMatches, filter, globalSections,  kGlob);
 
-		for(auto const& file : paths(directory))
+		for(size_t i = 2; i < files.size(); ++i)
 		{
-			auto const& s = sections(file);
+			auto const& s = *files[i];
 
 			orderScopeMatches.clear();
 			extract(directory, path, scope, orderScopeMatches, filter, s, kUnscoped|kScopeSelector);
@@ -223,6 +244,37 @@ namespace
 
 			extract(directory, path, scope, orderScopeMatches, filter, s, kGlob);
 		}
+		return res;
+	}
+
+	static void collect (std::string const& directory, std::string const& path, scope::scope_t const& scope, std::function<void(section_t::assignment_t const& assignment, section_t const& section)> filter)
+	{
+		static std::mutex mutex;
+		static std::map<std::string, std::shared_ptr<collected_t const>> cache;
+
+		std::shared_ptr<collected_t const> collected;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			sections(NULL_STR); // clear cache if too big
+
+			// Calling sections() re-reads changed files, so the generation tells if any of the cached results may be stale
+			std::vector<sections_ptr> files = { sections(default_settings_path()), sections(global_settings_path()) };
+			for(auto const& file : paths(directory))
+				files.push_back(sections(file));
+
+			std::string const key = directory + "\037" + path + "\037" + to_s(scope);
+			auto it = cache.find(key);
+			if(it == cache.end() || it->second->generation != sections_generation())
+			{
+				if(cache.size() > 256)
+					cache.clear();
+				it = cache.insert_or_assign(key, std::make_shared<collected_t const>(collect_assignments(directory, path, scope, files))).first;
+			}
+			collected = it->second;
+		}
+
+		for(auto const& pair : collected->assignments)
+			filter(*pair.first, *pair.second);
 	}
 
 	std::map<std::string, std::string> expanded_variables_for (std::string const& directory, std::string const& path, scope::scope_t const& scope, std::map<std::string, std::string> variables)
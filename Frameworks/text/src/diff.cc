@@ -0,0 +1,447 @@
+#include "diff.h"
+#include <oak/debug.h>
+
+// The comparison follows GNU diff (analyze.c and diffseq.h) closely so that
+// merges produced from these hunks match those of diff3(1) line for line.
+
+namespace
+{
+	static size_t const kHorizonLines = 100;
+
+	struct file_t
+	{
+		file_t (size_t lines) : changed_storage(lines + 2, 0), changed(&changed_storage[1]) { }
+
+		std::vector<size_t> equivs;      // equivalence class of each line
+		std::vector<size_t> undiscarded; // classes of the lines taking part in the comparison
+		std::vector<size_t> real_index;  // line number of each entry in ‘undiscarded’
+		std::vector<char> changed_storage;
+		char* changed;                   // has a zero sentinel before and after
+	};
+
+	struct partition_t
+	{
+		ssize_t xmid, ymid;
+		bool lo_minimal, hi_minimal;
+	};
+
+	struct context_t
+	{
+		context_t (file_t& x, file_t& y) : x(x), y(y)
+		{
+			ssize_t const diags = x.undiscarded.size() + y.undiscarded.size() + 3;
+			storage.resize(2 * diags);
+			fdiag = &storage[y.undiscarded.size() + 1];
+			bdiag = fdiag + diags;
+
+			too_expensive = 1;
+			for(ssize_t n = diags; n != 0; n >>= 2)
+				too_expensive <<= 1;
+			too_expensive = std::max<ssize_t>(4096, too_expensive);
+		}
+
+		bool equal (ssize_t xi, ssize_t yi) const { return x.undiscarded[xi] == y.undiscarded[yi]; }
+		void note_delete (ssize_t xi)             { x.changed[x.real_index[xi]] = 1; }
+		void note_insert (ssize_t yi)             { y.changed[y.real_index[yi]] = 1; }
+
+		file_t& x;
+		file_t& y;
+		std::vector<ssize_t> storage;
+		ssize_t* fdiag;
+		ssize_t* bdiag;
+		ssize_t too_expensive;
+	};
+
+	// Find the midpoint of the shortest edit script for x[xoff, xlim) and
+	// y[yoff, ylim) by searching forward and backward simultaneously. When
+	// the cost exceeds ‘too_expensive’ (and we are not asked for a minimal
+	// result) settle for the diagonal that got furthest.
+
+	static void diag (ssize_t xoff, ssize_t xlim, ssize_t yoff, ssize_t ylim, bool findMinimal, partition_t& part, context_t& ctxt)
+	{
+		ssize_t* const fd = ctxt.fdiag;
+		ssize_t* const bd = ctxt.bdiag;
+		ssize_t const dmin = xoff - ylim;
+		ssize_t const dmax = xlim - yoff;
+		ssize_t const fmid = xoff - yoff;
+		ssize_t const bmid = xlim - ylim;
+		ssize_t fmin = fmid, fmax = fmid;
+		ssize_t bmin = bmid, bmax = bmid;
+		bool const odd = (fmid - bmid) & 1;
+
+		fd[fmid] = xoff;
+		bd[bmid] = xlim;
+
+		for(ssize_t c = 1; ; ++c)
+		{
+			if(fmin > dmin)
+					fd[--fmin - 1] = -1;
+			else	++fmin;
+			if(fmax < dmax)
+					fd[++fmax + 1] = -1;
+			else	--fmax;
+
+			for(ssize_t d = fmax; d >= fmin; d -= 2)
+			{
+				ssize_t tlo = fd[d - 1], thi = fd[d + 1];
+				ssize_t x = tlo < thi ? thi : tlo + 1, y = x - d;
+				while(x < xlim && y < ylim && ctxt.equal(x, y))
+					++x, ++y;
+				fd[d] = x;
+				if(odd && bmin <= d && d <= bmax && bd[d] <= x)
+				{
+					part = { x, y, true, true };
+					return;
+				}
+			}
+
+			if(bmin > dmin)
+					bd[--bmin - 1] = SSIZE_MAX;
+			else	++bmin;
+			if(bmax < dmax)
+					bd[++bmax + 1] = SSIZE_MAX;
+			else	--bmax;
+
+			for(ssize_t d = bmax; d >= bmin; d -= 2)
+			{
+				ssize_t tlo = bd[d - 1], thi = bd[d + 1];
+				ssize_t x = tlo < thi ? tlo : thi - 1, y = x - d;
+				while(xoff < x && yoff < y && ctxt.equal(x - 1, y - 1))
+					--x, --y;
+				bd[d] = x;
+				if(!odd && fmin <= d && d <= fmax && x <= fd[d])
+				{
+					part = { x, y, true, true };
+					return;
+				}
+			}
+
+			if(!findMinimal && c >= ctxt.too_expensive)
+			{
+				ssize_t fxybest = -1, fxbest = 0;
+				for(ssize_t d = fmax; d >= fmin; d -= 2)
+				{
+					ssize_t x = std::min(fd[d], xlim), y = x - d;
+					if(ylim < y)
+						x = ylim + d, y = ylim;
+					if(fxybest < x + y)
+						fxybest = x + y, fxbest = x;
+				}
+
+				ssize_t bxybest = SSIZE_MAX, bxbest = 0;
+				for(ssize_t d = bmax; d >= bmin; d -= 2)
+				{
+					ssize_t x = std::max(xoff, bd[d]), y = x - d;
+					if(y < yoff)
+						x = yoff + d, y = yoff;
+					if(x + y < bxybest)
+						bxybest = x + y, bxbest = x;
+				}
+
+				if((xlim + ylim) - bxybest < fxybest - (xoff + yoff))
+						part = { fxbest, fxybest - fxbest, true, false };
+				else	part = { bxbest, bxybest - bxbest, false, true };
+				return;
+			}
+		}
+	}
+
+	static void compareseq (ssize_t xoff, ssize_t xlim, ssize_t yoff, ssize_t ylim, bool findMinimal, context_t& ctxt)
+	{
+		while(xoff < xlim && yoff < ylim && ctxt.equal(xoff, yoff))
+			++xoff, ++yoff;
+		while(xoff < xlim && yoff < ylim && ctxt.equal(xlim - 1, ylim - 1))
+			--xlim, --ylim;
+
+		if(xoff == xlim)
+		{
+			while(yoff < ylim)
+				ctxt.note_insert(yoff++);
+		}
+		else if(yoff == ylim)
+		{
+			while(xoff < xlim)
+				ctxt.note_delete(xoff++);
+		}
+		else
+		{
+			partition_t part;
+			diag(xoff, xlim, yoff, ylim, findMinimal, part, ctxt);
+			compareseq(xoff, part.xmid, yoff, part.ymid, part.lo_minimal, ctxt);
+			compareseq(part.xmid, xlim, part.ymid, ylim, part.hi_minimal, ctxt);
+		}
+	}
+
+	// Lines that match nothing in the other file are marked as changed up
+	// front, and so are runs of lines that match very many lines, as these
+	// only confuse the comparison.
+
+	static void discard_confusing_lines (file_t* files[2], size_t from[2], size_t to[2], size_t equivCount)
+	{
+		std::vector<size_t> counts[2] = { std::vector<size_t>(equivCount, 0), std::vector<size_t>(equivCount, 0) };
+		for(size_t f = 0; f < 2; ++f)
+		{
+			for(size_t i = from[f]; i < to[f]; ++i)
+				++counts[f][files[f]->equivs[i]];
+		}
+
+		std::vector<char> discarded[2];
+		for(size_t f = 0; f < 2; ++f)
+		{
+			size_t const end = to[f] - from[f];
+			discarded[f].resize(end, 0);
+
+			size_t many = 5;
+			for(size_t tem = end / 64; (tem >>= 2) > 0; )
+				many *= 2;
+
+			for(size_t i = 0; i < end; ++i)
+			{
+				size_t nmatch = counts[1 - f][files[f]->equivs[from[f] + i]];
+				if(nmatch == 0)
+					discarded[f][i] = 1;
+				else if(nmatch > many)
+					discarded[f][i] = 2;
+			}
+		}
+
+		for(size_t f = 0; f < 2; ++f)
+		{
+			char* discards = discarded[f].data();
+			ssize_t const end = discarded[f].size();
+
+			for(ssize_t i = 0; i < end; ++i)
+			{
+				if(discards[i] == 2)
+				{
+					discards[i] = 0;
+				}
+				else if(discards[i] != 0)
+				{
+					ssize_t j, provisional = 0;
+					for(j = i; j < end && discards[j] != 0; ++j)
+					{
+						if(discards[j] == 2)
+							++provisional;
+					}
+
+					while(j > i && discards[j - 1] == 2)
+						discards[--j] = 0, --provisional;
+
+					ssize_t const length = j - i;
+					if(provisional * 4 > length)
+					{
+						while(j > i)
+						{
+							if(discards[--j] == 2)
+								discards[j] = 0;
+						}
+					}
+					else
+					{
+						ssize_t minimum = 1, consec = 0;
+						for(ssize_t tem = length >> 2; 0 < (tem >>= 2); )
+							minimum <<= 1;
+						minimum++;
+
+						for(j = 0, consec = 0; j < length; ++j)
+						{
+							if(discards[i + j] != 2)
+								consec = 0;
+							else if(minimum == ++consec)
+								j -= consec;
+							else if(minimum < consec)
+								discards[i + j] = 0;
+						}
+
+						for(j = 0, consec = 0; j < length; ++j)
+						{
+							if(j >= 8 && discards[i + j] == 1)
+								break;
+							if(discards[i + j] == 2)
+								consec = 0, discards[i + j] = 0;
+							else if(discards[i + j] == 0)
+								consec = 0;
+							else
+								consec++;
+							if(consec == 3)
+								break;
+						}
+
+						i += length - 1;
+
+						for(j = 0, consec = 0; j < length; ++j)
+						{
+							if(j >= 8 && discards[i - j] == 1)
+								break;
+							if(discards[i - j] == 2)
+								consec = 0, discards[i - j] = 0;
+							else if(discards[i - j] == 0)
+								consec = 0;
+							else
+								consec++;
+							if(consec == 3)
+								break;
+						}
+					}
+				}
+			}
+		}
+
+		for(size_t f = 0; f < 2; ++f)
+		{
+			for(size_t i = 0; i < discarded[f].size(); ++i)
+			{
+				if(discarded[f][i] == 0)
+				{
+					files[f]->undiscarded.push_back(files[f]->equivs[from[f] + i]);
+					files[f]->real_index.push_back(from[f] + i);
+				}
+				else
+				{
+					files[f]->changed[from[f] + i] = 1;
+				}
+			}
+		}
+	}
+
+	// Slide each run of changes as far down as possible, merging it with
+	// adjacent runs, then back up to line up with a run of changes in the
+	// other file if there is one.
+
+	static void shift_boundaries (file_t* files[2])
+	{
+		for(size_t f = 0; f < 2; ++f)
+		{
+			char* changed             = files[f]->changed;
+			char const* otherChanged  = files[1 - f]->changed;
+			size_t const* equivs      = files[f]->equivs.data();
+			ssize_t const iEnd        = files[f]->equivs.size();
+
+			for(ssize_t i = 0, j = 0; ; )
+			{
+				while(i < iEnd && !changed[i])
+				{
+					while(otherChanged[j++])
+						continue;
+					i++;
+				}
+
+				if(i == iEnd)
+					break;
+
+				ssize_t start = i, runLength, corresponding;
+				while(changed[++i])
+					continue;
+				while(otherChanged[j])
+					j++;
+
+				do {
+					runLength = i - start;
+
+					while(start && equivs[start - 1] == equivs[i - 1])
+					{
+						changed[--start] = 1;
+						changed[--i] = 0;
+						while(changed[start - 1])
+							start--;
+						while(otherChanged[--j])
+							continue;
+					}
+
+					corresponding = otherChanged[j - 1] ? i : iEnd;
+
+					while(i != iEnd && equivs[start] == equivs[i])
+					{
+						changed[start++] = 0;
+						changed[i++] = 1;
+						while(changed[i])
+							i++;
+						while(otherChanged[++j])
+							corresponding = i;
+					}
+				} while(runLength != i - start);
+
+				while(corresponding < i)
+				{
+					changed[--start] = 1;
+					changed[--i] = 0;
+					while(otherChanged[--j])
+						continue;
+				}
+			}
+		}
+	}
+}
+
+namespace text
+{
+	std::vector<std::string_view> split_lines (std::string_view str)
+	{
+		std::vector<std::string_view> res;
+		for(size_t from = 0; from < str.size(); )
+		{
+			size_t to = str.find('\n', from);
+			to = to == std::string_view::npos ? str.size() : to + 1;
+			res.push_back(str.substr(from, to - from));
+			from = to;
+		}
+		return res;
+	}
+
+	std::vector<diff_hunk_t> diff_lines (std::vector<std::string_view> const& lhs, std::vector<std::string_view> const& rhs)
+	{
+		file_t x(lhs.size()), y(rhs.size());
+		file_t* files[2] = { &x, &y };
+
+		google::dense_hash_map<std::string_view, size_t, std::hash<std::string_view>> classes;
+		classes.set_empty_key(std::string_view()); // lines are never empty, they contain at least one byte
+		for(size_t f = 0; f < 2; ++f)
+		{
+			auto const& lines = f == 0 ? lhs : rhs;
+			files[f]->equivs.reserve(lines.size());
+			for(auto const& line : lines)
+				files[f]->equivs.push_back(classes.insert(std::make_pair(line, classes.size())).first->second);
+		}
+
+		// Like diff(1) with --horizon-lines=100 (as used by diff3) we skip
+		// identical leading and trailing lines but keep some of them in the
+		// comparison so that change boundaries can still be shifted.
+		size_t prefix = 0, suffix = 0;
+		while(prefix < lhs.size() && prefix < rhs.size() && x.equivs[prefix] == y.equivs[prefix])
+			++prefix;
+		while(suffix < lhs.size() - prefix && suffix < rhs.size() - prefix && x.equivs[lhs.size() - suffix - 1] == y.equivs[rhs.size() - suffix - 1])
+			++suffix;
+		prefix -= std::min(prefix, kHorizonLines);
+		suffix -= std::min(suffix, kHorizonLines);
+
+		size_t from[2] = { prefix, prefix };
+		size_t to[2]   = { lhs.size() - suffix, rhs.size() - suffix };
+		discard_confusing_lines(files, from, to, classes.size());
+
+		context_t ctxt(x, y);
+		compareseq(0, x.undiscarded.size(), 0, y.undiscarded.size(), false, ctxt);
+		shift_boundaries(files);
+
+		std::vector<diff_hunk_t> res;
+		for(size_t i = 0, j = 0; i < lhs.size() || j < rhs.size(); ++i, ++j)
+		{
+			if(x.changed[i] || y.changed[j])
+			{
+				size_t const firstFrom = i, secondFrom = j;
+				while(x.changed[i])
+					++i;
+				while(y.changed[j])
+					++j;
+				res.push_back({ firstFrom, i, secondFrom, j });
+			}
+		}
+		return res;
+	}
+
+	std::vector<diff_hunk_t> diff (std::string_view lhs, std::string_view rhs)
+	{
+		return diff_lines(split_lines(lhs), split_lines(rhs));
+	}
+
+} /* text */
@@ -0,0 +1,32 @@
+#ifndef TEXT_DIFF_H_Q4M7WZ2E
+#define TEXT_DIFF_H_Q4M7WZ2E
+
+#include <string_view>
+
+namespace text
+{
+	// A run of lines [first_from, first_to) in the first sequence that was
+	// replaced by [second_from, second_to) in the second. One of the ranges
+	// is empty for pure insertions and deletions.
+	struct diff_hunk_t
+	{
+		size_t first_from, first_to;
+		size_t second_from, second_to;
+
+		bool operator== (diff_hunk_t const& rhs) const { return first_from == rhs.first_from && first_to == rhs.first_to && second_from == rhs.second_from && second_to == rhs.second_to; }
+		bool operator!= (diff_hunk_t const& rhs) const { return !(*this == rhs); }
+	};
+
+	// Lines include their trailing newline, the last one may lack it. The
+	// views point into ‘str’ which must outlive the result.
+	std::vector<std::string_view> split_lines (std::string_view str);
+
+	// Line based diff using the Myers O(ND) algorithm with the same
+	// refinements as GNU diff (discarding confusing lines, shifting change
+	// boundaries) so results match what diff(1) reports.
+	std::vector<diff_hunk_t> diff_lines (std::vector<std::string_view> const& lhs, std::vector<std::string_view> const& rhs);
+	std::vector<diff_hunk_t> diff (std::string_view lhs, std::string_view rhs);
+
+} /* text */
+
+#endif /* end of include guard: TEXT_DIFF_H_Q4M7WZ2E */
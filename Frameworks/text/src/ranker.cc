@@ -216,4 +216,92 @@ namespace oak
 		return filter.size() * candidate.size() > 8096 ? filter.size() / candidate.size() : calculate_rank(filter, candidate, out);
 	}
 
+	// ============
+	// = ranker_t =
+	// ============
+
+	static uint64_t character_mask (std::string const& str)
+	{
+		uint64_t res = 0;
+		for(char ch : str)
+		{
+			uint8_t c = tolower((uint8_t)ch);
+			if('a' <= c && c <= 'z')
+				res |= uint64_t(1) << (c - 'a');
+			else if('0' <= c && c <= '9')
+				res |= uint64_t(1) << (26 + c - '0');
+			else
+				res |= uint64_t(1) << (36 + c % 28);
+		}
+		return res;
+	}
+
+	static bool is_subsequence (std::string const& needle, std::string const& haystack)
+	{
+		std::string::size_type n = 0;
+		for(std::string::size_type m = 0; n < needle.size() && m < haystack.size(); ++m)
+		{
+			if(needle[n] == haystack[m])
+				++n;
+		}
+		return n == needle.size();
+	}
+
+	void ranker_t::add (std::string const& candidate)
+	{
+		_candidates.push_back(candidate);
+		_masks.push_back(character_mask(candidate));
+	}
+
+	void ranker_t::clear ()
+	{
+		_candidates.clear();
+		_masks.clear();
+		_filter.clear();
+		_matches.clear();
+		_checked = 0;
+	}
+
+	std::vector<size_t> const& ranker_t::filter (std::string const& filter)
+	{
+		if(!is_subsequence(_filter, filter)) // everything matching ‘filter’ also matches ‘_filter’ so otherwise we start over
+		{
+			_matches.clear();
+			_checked = 0;
+		}
+
+		std::vector<size_t> candidates;
+		if(_filter != filter)
+			candidates.swap(_matches);
+		for(size_t i = _checked; i < _candidates.size(); ++i)
+			candidates.push_back(i);
+
+		std::vector<char> keep(candidates.size());
+
+		size_t const count = candidates.size();
+		size_t const stride = 4096;
+		uint64_t const mask = character_mask(filter);
+
+		size_t const* ids         = candidates.data();
+		char* flags               = keep.data();
+		std::string const* strs   = _candidates.data();
+		uint64_t const* masks     = _masks.data();
+		std::string const* needle = &filter;
+
+		dispatch_apply((count + stride - 1) / stride, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0), ^(size_t n){
+			for(size_t i = n * stride; i < std::min((n + 1) * stride, count); ++i)
+				flags[i] = (mask & ~masks[ids[i]]) == 0 && is_subset(*needle, strs[ids[i]]);
+		});
+
+		for(size_t i = 0; i < count; ++i)
+		{
+			if(keep[i])
+				_matches.push_back(candidates[i]);
+		}
+
+		_filter  = filter;
+		_checked = _candidates.size();
+		return _matches;
+	}
+
 } /* oak */
@@ -7,6 +7,28 @@ namespace oak
 {
 	std::string normalize_filter (std::string const& filter);
 	double rank (std::string const& filter, std::string const& candidate, std::vector< std::pair<size_t, size_t> >* out = NULL);
+
+	// Ranks a growing list of candidates against a filter that typically
+	// changes one character at a time. Each candidate has a bitmask of the
+	// characters it contains for quick rejection, and when the new filter
+	// extends the previous one only the previous matches are examined.
+	struct ranker_t
+	{
+		void add (std::string const& candidate);
+		void clear ();
+		size_t size () const { return _candidates.size(); }
+
+		// Indices (ascending) of candidates that contain ‘filter’ as a subsequence
+		std::vector<size_t> const& filter (std::string const& filter);
+
+	private:
+		std::vector<std::string> _candidates;
+		std::vector<uint64_t> _masks;
+
+		std::string _filter;
+		std::vector<size_t> _matches;
+		size_t _checked = 0;
+	};
 }
 
 #endif /* end of include guard: RANKER_KFO7JS5A */
@@ -0,0 +1,32 @@
+#include <text/diff.h>
+
+void test_split_lines ()
+{
+	OAK_ASSERT_EQ(text::split_lines("").size(), 0);
+	OAK_ASSERT_EQ(text::split_lines("foo").size(), 1);
+	OAK_ASSERT_EQ(text::split_lines("foo\nbar\n").size(), 2);
+	OAK_ASSERT_EQ(text::split_lines("foo\nbar\n").back(), "bar\n");
+	OAK_ASSERT_EQ(text::split_lines("foo\n\nbar").back(), "bar");
+}
+
+void test_diff ()
+{
+	OAK_ASSERT(text::diff("a\nb\nc\n", "a\nb\nc\n").empty());
+
+	auto hunks = text::diff("1\n2\n3\n4\n5\n", "1\nA\n3\n4\n5\n6\n");
+	OAK_ASSERT_EQ(hunks.size(), 2);
+	OAK_ASSERT(hunks[0] == (text::diff_hunk_t{ 1, 2, 1, 2 }));
+	OAK_ASSERT(hunks[1] == (text::diff_hunk_t{ 5, 5, 5, 6 }));
+
+	hunks = text::diff("a\nb\nc", "a\nc\nd\n");
+	OAK_ASSERT_EQ(hunks.size(), 1);
+	OAK_ASSERT(hunks[0] == (text::diff_hunk_t{ 1, 3, 1, 3 }));
+}
+
+void test_diff_shift_boundaries ()
+{
+	// Like diff(1) an inserted run of repeated lines is reported as late as possible
+	auto hunks = text::diff("x\na\nb\ny\n", "x\na\nb\na\nb\ny\n");
+	OAK_ASSERT_EQ(hunks.size(), 1);
+	OAK_ASSERT(hunks[0] == (text::diff_hunk_t{ 3, 3, 3, 5 }));
+}
@@ -1,4 +1,6 @@
 #include <text/ranker.h>
+#include <text/format.h>
+#include <test/benchmark.h>
 
 void test_capital_coverage ()
 {
@@ -72,3 +74,35 @@ void test_highlight_range ()
 	OAK_ASSERT_EQ(ranges[1].first,  4);
 	OAK_ASSERT_EQ(ranges[1].second, 5);
 }
+
+void test_incremental_ranker ()
+{
+	oak::ranker_t ranker;
+	ranker.add("Frameworks/text/src/ranker.cc");
+	ranker.add("Frameworks/OakTextView/src/OakTextView.mm");
+	ranker.add("Frameworks/OakTabBarView/src/OakTabBarView.mm");
+	ranker.add("README.md");
+
+	OAK_ASSERT_EQ(ranker.filter("o").size(), 3);
+	OAK_ASSERT_EQ(ranker.filter("otv").size(), 2);
+	OAK_ASSERT_EQ(ranker.filter("otvm").size(), 2);
+	OAK_ASSERT_EQ(ranker.filter("q").size(), 0);
+
+	ranker.add("OTVStatusBar.mm");
+	OAK_ASSERT_EQ(ranker.filter("o").size(), 4);
+	OAK_ASSERT_EQ(ranker.filter("otv").size(), 3);
+}
+
+void benchmark_rank ()
+{
+	std::vector<std::string> candidates;
+	for(size_t i = 0; i < 10000; ++i)
+		candidates.push_back(text::format("Frameworks/framework%zu/src/source_file_%zu.cc", i % 97, i));
+
+	test::benchmark("ranker.rank", [&](){
+		size_t matches = 0;
+		for(auto const& candidate : candidates)
+			matches += oak::rank("srcfile", candidate) > 0 ? 1 : 0;
+		OAK_ASSERT_EQ(matches, candidates.size());
+	});
+}
@@ -0,0 +1,259 @@
+#include "arena.h"
+#include <io/src/path.h>
+
+namespace ng
+{
+	namespace detail
+	{
+		static size_t const kSegmentSize = 256*1024;
+
+		arena_t::arena_t (size_t budget) : _budget(budget)
+		{
+		}
+
+		arena_t::~arena_t ()
+		{
+			if(_fd != -1)
+				close(_fd);
+		}
+
+		arena_t::ref_t arena_t::append (char const* buf, size_t len)
+		{
+			if(len == 0)
+				return ref_t();
+
+			if(_segments.empty() || (!_segments.back().bytes.empty() && _segments.back().bytes.size() + len > kSegmentSize))
+			{
+				if(!_segments.empty() && _segments.back().live == 0)
+					drop(_segments.back());
+				_segments.emplace_back();
+				_segments.back().bytes.reserve(std::max(len, kSegmentSize));
+			}
+
+			segment_t& segment = _segments.back();
+			ref_t res;
+			res.segment = _segments.size() - 1;
+			res.offset  = segment.bytes.size();
+			res.length  = len;
+
+			segment.bytes.append(buf, len);
+			segment.size = segment.bytes.size();
+			segment.live += len;
+			segment.last_use = ++_clock;
+			_resident += len;
+
+			enforce_budget();
+			return res;
+		}
+
+		bool arena_t::join (ref_t& lhs, ref_t const& rhs) const
+		{
+			if(rhs.empty())
+				return true;
+			else if(lhs.empty())
+				lhs = rhs;
+			else if(lhs.segment == rhs.segment && lhs.offset + lhs.length == rhs.offset)
+				lhs.length += rhs.length;
+			else
+				return false;
+			return true;
+		}
+
+		void arena_t::release (ref_t const& ref)
+		{
+			if(ref.empty())
+				return;
+
+			ASSERT_LT(ref.segment, _segments.size());
+			segment_t& segment = _segments[ref.segment];
+			ASSERT_LE(ref.length, segment.live);
+			if((segment.live -= ref.length) != 0)
+				return;
+
+			if(ref.segment + 1 == _segments.size()) // still being appended to so start over
+			{
+				_resident -= segment.size;
+				segment.bytes.clear();
+				segment.size = 0;
+			}
+			else
+			{
+				drop(segment);
+			}
+		}
+
+		bool arena_t::read (ref_t const& ref, std::string& out)
+		{
+			out.clear();
+			if(ref.empty())
+				return true;
+
+			segment_t const* segment = load(ref.segment);
+			if(!segment)
+				return false;
+			out.assign(segment->bytes, ref.offset, ref.length);
+			return true;
+		}
+
+		void arena_t::set_budget (size_t budget)
+		{
+			_budget = budget;
+			enforce_budget();
+		}
+
+		arena_t::segment_t* arena_t::load (size_t index)
+		{
+			ASSERT_LT(index, _segments.size());
+			segment_t& segment = _segments[index];
+			if(!segment.resident)
+			{
+				ASSERT_NE(segment.spill_offset, -1);
+
+				std::string compressed(segment.spill_size, '\0');
+				uLongf len = segment.size;
+				segment.bytes.resize(segment.size);
+				if(pread(_fd, &compressed[0], compressed.size(), segment.spill_offset) != ssize_t(compressed.size()) || uncompress((Bytef*)&segment.bytes[0], &len, (Bytef const*)compressed.data(), compressed.size()) != Z_OK || len != segment.size)
+				{
+					os_log_error(OS_LOG_DEFAULT, "Failed to read %zu bytes of undo history from spill file", segment.size);
+					std::string().swap(segment.bytes);
+					return nullptr;
+				}
+
+				segment.resident = true;
+				_resident += segment.size;
+			}
+			segment.last_use = ++_clock;
+			enforce_budget(index);
+			return &segment;
+		}
+
+		void arena_t::spill (segment_t& segment)
+		{
+			if(segment.spill_offset == -1) // segments are immutable once sealed so a previous spill can be reused
+			{
+				uLongf len = compressBound(segment.size);
+				std::string compressed(len, '\0');
+				if(compress2((Bytef*)&compressed[0], &len, (Bytef const*)segment.bytes.data(), segment.size, Z_BEST_SPEED) != Z_OK)
+					return;
+
+				off_t const offset = allocate(len);
+				if(pwrite(_fd, compressed.data(), len, offset) != ssize_t(len))
+				{
+					os_log_error(OS_LOG_DEFAULT, "Failed to write undo history to spill file: %{errno}d", errno);
+					deallocate(offset, len);
+					_spill_failed = true;
+					return;
+				}
+
+				segment.spill_offset = offset;
+				segment.spill_size   = len;
+			}
+
+			_resident -= segment.size;
+			std::string().swap(segment.bytes);
+			segment.resident = false;
+		}
+
+		void arena_t::drop (segment_t& segment)
+		{
+			if(segment.resident)
+				_resident -= segment.size;
+			if(segment.spill_offset != -1)
+				deallocate(segment.spill_offset, segment.spill_size);
+
+			std::string().swap(segment.bytes);
+			segment.size         = 0;
+			segment.spill_offset = -1;
+			segment.spill_size   = 0;
+			segment.resident     = false;
+		}
+
+		// First fit in the holes left by dropped segments, else append
+		off_t arena_t::allocate (size_t len)
+		{
+			for(auto it = _free_extents.begin(); it != _free_extents.end(); ++it)
+			{
+				if(it->second < len)
+					continue;
+
+				off_t const res = it->first;
+				if(it->second > len)
+					_free_extents.emplace(res + len, it->second - len);
+				_free_extents.erase(it);
+				return res;
+			}
+
+			off_t const res = _file_size;
+			_file_size += len;
+			return res;
+		}
+
+		void arena_t::deallocate (off_t offset, size_t len)
+		{
+			auto next = _free_extents.lower_bound(offset);
+			if(next != _free_extents.end() && offset + off_t(len) == next->first)
+			{
+				len += next->second;
+				next = _free_extents.erase(next);
+			}
+
+			if(next != _free_extents.begin())
+			{
+				auto prev = std::prev(next);
+				if(prev->first + off_t(prev->second) == offset)
+				{
+					offset = prev->first;
+					len   += prev->second;
+					_free_extents.erase(prev);
+				}
+			}
+
+			if(offset + off_t(len) == _file_size)
+			{
+				_file_size = offset;
+				if(ftruncate(_fd, _file_size) != 0)
+					os_log_error(OS_LOG_DEFAULT, "Failed to truncate undo spill file: %{errno}d", errno);
+			}
+			else
+			{
+				_free_extents.emplace(offset, len);
+			}
+		}
+
+		void arena_t::enforce_budget (size_t keep)
+		{
+			while(_resident > _budget && !_spill_failed)
+			{
+				segment_t* victim = nullptr;
+				for(size_t i = 0; i + 1 < _segments.size(); ++i) // last segment is still being appended to
+				{
+					if(i != keep && _segments[i].resident && (!victim || _segments[i].last_use < victim->last_use))
+						victim = &_segments[i];
+				}
+
+				if(!victim || (_fd == -1 && !open_spill_file()))
+					break;
+
+				spill(*victim);
+				if(victim->resident)
+					break;
+			}
+		}
+
+		bool arena_t::open_spill_file ()
+		{
+			std::string const tempPath = path::temp("undo");
+			_fd = open(tempPath.c_str(), O_RDWR|O_CREAT|O_EXCL|O_CLOEXEC, S_IRUSR|S_IWUSR);
+			if(_fd == -1)
+			{
+				os_log_error(OS_LOG_DEFAULT, "Failed to create undo spill file ‘%{public}s’: %{errno}d", tempPath.c_str(), errno);
+				_spill_failed = true;
+				return false;
+			}
+			unlink(tempPath.c_str()); // keep the file anonymous, space is reclaimed when we close it
+			return true;
+		}
+
+	} /* detail */
+
+} /* ng */
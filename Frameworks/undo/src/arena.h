@@ -0,0 +1,79 @@
+#ifndef UNDO_ARENA_H_K7TQ2XWB
+#define UNDO_ARENA_H_K7TQ2XWB
+
+#include <oak/debug.h>
+
+namespace ng
+{
+	namespace detail
+	{
+		// Append-only byte store for undo history. Text is referenced by
+		// (segment, offset, length). Sealed segments are compressed to an
+		// unlinked temporary file when resident bytes exceed the budget and
+		// paged back in on demand. Segments without live references are
+		// dropped and their space in the temporary file is reused.
+
+		struct arena_t
+		{
+			struct ref_t
+			{
+				size_t segment = 0;
+				size_t offset  = 0;
+				size_t length  = 0;
+
+				size_t size () const  { return length; }
+				bool empty () const   { return length == 0; }
+			};
+
+			arena_t (size_t budget);
+			~arena_t ();
+
+			ref_t append (char const* buf, size_t len);
+			ref_t append (std::string const& str) { return append(str.data(), str.size()); }
+			bool join (ref_t& lhs, ref_t const& rhs) const;
+			void release (ref_t const& ref);
+
+			// Returns false if the text could not be paged back in
+			bool read (ref_t const& ref, std::string& out);
+			std::string str (ref_t const& ref) { std::string res; read(ref, res); return res; }
+
+			void set_budget (size_t budget);
+			size_t budget () const   { return _budget; }
+			size_t resident () const { return _resident; }
+			off_t spill_size () const { return _file_size; }
+
+		private:
+			struct segment_t
+			{
+				std::string bytes;
+				size_t size = 0;
+				size_t live = 0;
+				off_t spill_offset = -1;
+				size_t spill_size = 0;
+				bool resident = true;
+				size_t last_use = 0;
+			};
+
+			segment_t* load (size_t index);
+			void spill (segment_t& segment);
+			void drop (segment_t& segment);
+			off_t allocate (size_t len);
+			void deallocate (off_t offset, size_t len);
+			void enforce_budget (size_t keep = SIZE_T_MAX);
+			bool open_spill_file ();
+
+			std::vector<segment_t> _segments;
+			size_t _budget;
+			size_t _resident = 0;
+			size_t _clock = 0;
+			int _fd = -1;
+			bool _spill_failed = false;
+			off_t _file_size = 0;
+			std::map<off_t, size_t> _free_extents;
+		};
+
+	} /* detail */
+
+} /* ng */
+
+#endif /* end of include guard: UNDO_ARENA_H_K7TQ2XWB */
@@ -2,7 +2,9 @@
 
 namespace ng
 {
-	undo_manager_t::undo_manager_t (buffer_t& buffer) : _buffer(buffer), _buffer_callback(*this)
+	static size_t const kDefaultMemoryBudget = 32*1024*1024;
+
+	undo_manager_t::undo_manager_t (buffer_t& buffer) : _buffer(buffer), _buffer_callback(*this), _arena(kDefaultMemoryBudget)
 	{
 		_buffer.add_callback(&_buffer_callback);
 	}
@@ -10,6 +12,8 @@ namespace ng
 	undo_manager_t::~undo_manager_t ()
 	{
 		_buffer.remove_callback(&_buffer_callback);
+		if(_history_fd != -1)
+			close(_history_fd);
 	}
 
 	bool undo_manager_t::can_undo () const      { return _index != 0;               }
@@ -36,8 +40,14 @@ namespace ng
 		}
 	}
 
-	bool undo_manager_t::should_merge (record_t const& r, record_t const& t)
+	bool undo_manager_t::should_merge (record_t const& rRecord, record_t const& tRecord)
 	{
+		if(rRecord.changes.size() != 1 || tRecord.changes.size() != 1)
+			return false;
+
+		change_t const& r = rRecord.changes.front();
+		change_t const& t = tRecord.changes.front();
+
 		bool rWasInsertEvent = r.before.size() == 0 && r.after.size() != 0;
 		bool rWasEraseEvent  = r.before.size() != 0 && r.after.size() == 0;
 		bool tWasInsertEvent = t.before.size() == 0 && t.after.size() != 0;
@@ -45,30 +55,116 @@ namespace ng
 		if(rWasInsertEvent != tWasInsertEvent || rWasEraseEvent != tWasEraseEvent)
 			return false;
 
-		bool rWasAllWhitespace = (rWasInsertEvent ? r.after : r.before).find_first_not_of(" \n\t") == std::string::npos;
-		bool rWasNoWhitespace  = (rWasInsertEvent ? r.after : r.before).find_first_of(" \n\t") == std::string::npos;
-		bool tWasAllWhitespace = (tWasInsertEvent ? t.after : t.before).find_first_not_of(" \n\t") == std::string::npos;
-		bool tWasNoWhitespace  = (tWasInsertEvent ? t.after : t.before).find_first_of(" \n\t") == std::string::npos;
+		std::string const rText = _arena.str(rWasInsertEvent ? r.after : r.before);
+		std::string const tText = _arena.str(tWasInsertEvent ? t.after : t.before);
+
+		bool rWasAllWhitespace = rText.find_first_not_of(" \n\t") == std::string::npos;
+		bool rWasNoWhitespace  = rText.find_first_of(" \n\t") == std::string::npos;
+		bool tWasAllWhitespace = tText.find_first_not_of(" \n\t") == std::string::npos;
+		bool tWasNoWhitespace  = tText.find_first_of(" \n\t") == std::string::npos;
 
 		return (rWasAllWhitespace || rWasNoWhitespace) && rWasAllWhitespace == tWasAllWhitespace && rWasNoWhitespace == tWasNoWhitespace;
 	}
 
+	// Fold ‘t’ into the preceding record ‘r’ when undo and redo would always
+	// step over the boundary between them anyway, i.e. a typing run. Inserts
+	// and forward deletes have their text adjacent in the arena so no bytes
+	// are copied, backspace runs are copied up to kMaxCopiedRun bytes.
+	static size_t const kMaxCopiedRun = 4096;
+
+	bool undo_manager_t::coalesce (record_t& rRecord, record_t const& tRecord)
+	{
+		if(rRecord.file_offset != -1 || tRecord.file_offset != -1)
+			return false;
+		if(tRecord.pre_selection.empty() ? !rRecord.post_selection.empty() : tRecord.pre_selection != rRecord.post_selection)
+			return false;
+		if(!should_merge(rRecord, tRecord))
+			return false;
+
+		change_t& r = rRecord.changes.front();
+		change_t const& t = tRecord.changes.front();
+
+		bool didInsert    = r.before.empty() && t.pos == r.pos + r.after.size() && _arena.join(r.after, t.after);
+		bool didDelete    = !didInsert && r.after.empty() && t.pos == r.pos && _arena.join(r.before, t.before);
+		bool didBackspace = false;
+		if(!didInsert && !didDelete && r.after.empty() && t.pos + t.before.size() == r.pos && t.before.size() + r.before.size() <= kMaxCopiedRun)
+		{
+			std::string tText, rText;
+			if(_arena.read(t.before, tText) && _arena.read(r.before, rText))
+			{
+				detail::arena_t::ref_t const before = _arena.append(tText + rText);
+				_arena.release(r.before);
+				_arena.release(t.before);
+				r.pos    = t.pos;
+				r.before = before;
+				didBackspace = true;
+			}
+		}
+
+		if(!didInsert && !didDelete && !didBackspace)
+			return false;
+
+		rRecord.post_selection = tRecord.post_selection;
+		rRecord.post_revision  = tRecord.post_revision;
+		return true;
+	}
+
+	bool undo_manager_t::replacements_for (record_t const& r, bool undo, std::vector<replacement_t>& replacements)
+	{
+		ssize_t delta = 0;
+		for(auto const& c : r.changes)
+		{
+			std::string str;
+			if(!_arena.read(undo ? c.before : c.after, str))
+				return false;
+
+			size_t const from = undo ? c.pos + delta : c.pos;
+			size_t const to   = from + (undo ? c.after : c.before).size();
+			if(undo)
+				delta += c.after.size() - c.before.size();
+			replacements.emplace_back(from, to, str);
+		}
+		return true;
+	}
+
+	void undo_manager_t::discard_records (size_t from, size_t to)
+	{
+		for(size_t i = from; i < to; ++i)
+		{
+			for(auto const& c : _records[i].changes)
+			{
+				_arena.release(c.before);
+				_arena.release(c.after);
+			}
+		}
+		_records.erase(_records.begin() + from, _records.begin() + to);
+	}
+
 	ranges_t undo_manager_t::undo ()
 	{
 		ASSERT(can_undo());
 
 		_buffer.remove_callback(&_buffer_callback);
 		ranges_t res;
-		size_t rev;
+		size_t rev = _buffer.revision();
 		while(res.empty())
 		{
 			ASSERT(_index != 0);
+			std::vector<replacement_t> replacements;
+			if(!page_in(_index-1) || !replacements_for(_records[_index-1], true, replacements))
+			{
+				os_log_error(OS_LOG_DEFAULT, "Discarding %zu undo steps that could not be read back", _index);
+				discard_records(0, _index);
+				_index = 0;
+				break;
+			}
+
 			record_t const& r = _records[--_index];
-			_buffer.replace(r.pos, r.pos + r.after.size(), r.before);
+			_buffer.replace(replacements);
 			res = r.pre_selection;
 			rev = r.pre_revision;
 
-			if(_index != 0 && _index != _records.size()-1 && res == _records[_index-1].post_selection && should_merge(r, _records[_index-1]))
+			if(_index != 0 && _index != _records.size()-1 && page_in(_index-1) && res == _records[_index-1].post_selection && should_merge(r, _records[_index-1]))
 				res = ranges_t();
 		}
 		_buffer.set_revision(rev);
@@ -83,16 +179,24 @@ namespace ng
 
 		_buffer.remove_callback(&_buffer_callback);
 		ranges_t res;
-		size_t rev;
+		size_t rev = _buffer.revision();
 		while(res.empty())
 		{
 			ASSERT(_index != _records.size());
+			std::vector<replacement_t> replacements;
+			if(!page_in(_index) || !replacements_for(_records[_index], false, replacements))
+			{
+				os_log_error(OS_LOG_DEFAULT, "Discarding %zu redo steps that could not be read back", _records.size() - _index);
+				discard_records(_index, _records.size());
+				break;
+			}
+
 			record_t const& r = _records[_index++];
-			_buffer.replace(r.pos, r.pos + r.before.size(), r.after);
+			_buffer.replace(replacements);
 			res = r.post_selection;
 			rev = r.post_revision;
 
-			if(_index != _records.size() && res == _records[_index].pre_selection && should_merge(r, _records[_index]))
+			if(_index != _records.size() && page_in(_index) && res == _records[_index].pre_selection && should_merge(r, _records[_index]))
 				res = ranges_t();
 		}
 		_buffer.set_revision(rev);
@@ -101,13 +205,346 @@ namespace ng
 		return res;
 	}
 
-	void undo_manager_t::will_replace (size_t from, size_t to, char const* buf, size_t len)
+	void undo_manager_t::add_record (std::vector<change_t> const& changes)
 	{
-		_records.erase(_records.begin() + _index, _records.end());
-		_records.emplace_back(from, _buffer.substr(from, to), std::string(buf, len), _pre_selection, _pre_revision);
+		discard_records(_index, _records.size());
+
+		// The last record is never folded as undo treats it specially, instead we fold it when the next record arrives
+		if(_index > 1 && coalesce(_records[_index-2], _records[_index-1]))
+		{
+			_records.pop_back();
+			--_index;
+		}
+
+		_records.emplace_back(changes, _pre_selection, _pre_revision);
 		_pre_selection = ranges_t();
 		++_changes;
 		++_index;
 	}
 
+	void undo_manager_t::will_replace (size_t from, size_t to, char const* buf, size_t len)
+	{
+		add_record({ { from, _arena.append(_buffer.substr(from, to)), _arena.append(buf, len) } });
+	}
+
+	void undo_manager_t::will_replace_batch (std::vector<replacement_t> const& replacements)
+	{
+		std::vector<change_t> changes;
+		changes.reserve(replacements.size());
+		for(auto const& r : replacements)
+			changes.push_back({ r.from, _arena.append(_buffer.substr(r.from, r.to)), _arena.append(r.str) });
+		add_record(changes);
+	}
+
+	// ===========
+	// = History =
+	// ===========
+
+	static char const kHistoryMagic[4]    = { 'T', 'M', 'U', 'H' };
+	static uint32_t const kHistoryVersion = 2;
+
+	// Followed by the document path, the record bodies and the index
+	struct history_header_t
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t content_size;
+		uint64_t document_size;
+		int64_t document_mtime_sec;
+		int64_t document_mtime_nsec;
+		uint64_t path_length;
+		uint64_t record_count;
+		uint64_t index;
+		uint64_t revision;
+		uint64_t index_offset;
+	};
+
+	struct history_entry_t
+	{
+		uint64_t offset;
+		uint64_t length;
+		uint64_t pre_revision;
+		uint64_t post_revision;
+	};
+
+	static void append_number (std::string& dst, uint64_t value)
+	{
+		for(; value >= 0x80; value >>= 7)
+			dst.push_back(char(value | 0x80));
+		dst.push_back(char(value));
+	}
+
+	static bool parse_number (char const*& p, char const* end, uint64_t& value)
+	{
+		value = 0;
+		for(size_t shift = 0; p != end && shift < 64; shift += 7)
+		{
+			uint8_t byte = *p++;
+			value |= uint64_t(byte & 0x7F) << shift;
+			if((byte & 0x80) == 0)
+				return true;
+		}
+		return false;
+	}
+
+	static void append_ranges (std::string& dst, ranges_t const& ranges)
+	{
+		append_number(dst, ranges.size());
+		for(auto const& range : ranges)
+		{
+			append_number(dst, range.first.index);
+			append_number(dst, range.first.carry);
+			append_number(dst, range.last.index);
+			append_number(dst, range.last.carry);
+			append_number(dst, (range.columnar ? 1 : 0) | (range.freehanded ? 2 : 0) | (range.unanchored ? 4 : 0) | (range.color ? 8 : 0));
+		}
+	}
+
+	static bool parse_ranges (char const*& p, char const* end, ranges_t& ranges)
+	{
+		uint64_t count;
+		if(!parse_number(p, end, count))
+			return false;
+
+		while(count--)
+		{
+			uint64_t v[5];
+			for(auto& n : v)
+			{
+				if(!parse_number(p, end, n))
+					return false;
+			}
+
+			range_t range;
+			range.first      = index_t(v[0], v[1]);
+			range.last       = index_t(v[2], v[3]);
+			range.columnar   = v[4] & 1;
+			range.freehanded = v[4] & 2;
+			range.unanchored = v[4] & 4;
+			range.color      = v[4] & 8;
+			ranges.push_back(range);
+		}
+		return true;
+	}
+
+	// Hashing the content would block the main thread for large documents, so the history is tied to the document on disk
+	static bool document_matches (history_header_t const& header, std::string const& documentPath, size_t contentSize)
+	{
+		struct stat buf;
+		if(stat(documentPath.c_str(), &buf) != 0)
+			return false;
+		return header.content_size == contentSize && header.document_size == uint64_t(buf.st_size) && header.document_mtime_sec == buf.st_mtimespec.tv_sec && header.document_mtime_nsec == buf.st_mtimespec.tv_nsec;
+	}
+
+	std::string undo_manager_t::serialize (record_t const& record)
+	{
+		std::string res;
+		append_number(res, record.changes.size());
+		for(auto const& c : record.changes)
+		{
+			append_number(res, c.pos);
+			append_number(res, c.before.size());
+			res += _arena.str(c.before);
+			append_number(res, c.after.size());
+			res += _arena.str(c.after);
+		}
+		append_ranges(res, record.pre_selection);
+		append_ranges(res, record.post_selection);
+		return res;
+	}
+
+	bool undo_manager_t::page_in (size_t i)
+	{
+		record_t& record = _records[i];
+		if(record.file_offset == -1)
+			return true;
+
+		if(record.file_length > uint64_t(_history_size) || record.file_offset > _history_size - off_t(record.file_length))
+		{
+			os_log_error(OS_LOG_DEFAULT, "Undo record %zu (offset %lld, length %zu) is outside the history file", i, record.file_offset, record.file_length);
+			return false;
+		}
+
+		std::string body(record.file_length, '\0');
+		bool ok = pread(_history_fd, &body[0], body.size(), record.file_offset) == ssize_t(body.size());
+
+		char const* p   = body.data();
+		char const* end = p + body.size();
+
+		std::vector<change_t> changes;
+		ranges_t preSelection, postSelection;
+
+		uint64_t count;
+		ok = ok && parse_number(p, end, count);
+		auto parse_text = [&](detail::arena_t::ref_t& ref) -> bool {
+			uint64_t len;
+			if(!parse_number(p, end, len) || len > uint64_t(end - p))
+				return false;
+			ref = _arena.append(p, len);
+			p += len;
+			return true;
+		};
+
+		for(uint64_t j = 0; ok && j < count; ++j)
+		{
+			uint64_t pos;
+			change_t c;
+			ok = parse_number(p, end, pos) && parse_text(c.before) && parse_text(c.after);
+			c.pos = pos;
+			changes.push_back(c);
+		}
+
+		if(!ok || !parse_ranges(p, end, preSelection) || !parse_ranges(p, end, postSelection))
+		{
+			for(auto const& c : changes)
+			{
+				_arena.release(c.before);
+				_arena.release(c.after);
+			}
+			os_log_error(OS_LOG_DEFAULT, "Failed to read undo record %zu (offset %lld) from history file", i, record.file_offset);
+			return false;
+		}
+
+		record.changes.swap(changes);
+		record.pre_selection  = preSelection;
+		record.post_selection = postSelection;
+		record.file_offset    = -1;
+		return true;
+	}
+
+	bool undo_manager_t::save (std::string const& path, std::string const& documentPath)
+	{
+		struct stat buf;
+		if(stat(documentPath.c_str(), &buf) != 0)
+			return false;
+
+		std::string tmp = path + ".XXXXXX";
+		int fd = mkstemp(&tmp[0]);
+		if(fd == -1)
+		{
+			os_log_error(OS_LOG_DEFAULT, "Failed to create undo history ‘%{public}s’: %{errno}d", tmp.c_str(), errno);
+			return false;
+		}
+
+		history_header_t header;
+		std::copy(std::begin(kHistoryMagic), std::end(kHistoryMagic), header.magic);
+		header.version             = kHistoryVersion;
+		header.content_size        = _buffer.size();
+		header.document_size       = buf.st_size;
+		header.document_mtime_sec  = buf.st_mtimespec.tv_sec;
+		header.document_mtime_nsec = buf.st_mtimespec.tv_nsec;
+		header.path_length         = documentPath.size();
+		header.record_count        = _records.size();
+		header.index               = _index;
+		header.revision            = _buffer.revision();
+
+		std::vector<history_entry_t> entries;
+		entries.reserve(_records.size());
+
+		bool ok = true;
+		off_t offset = sizeof(header) + documentPath.size();
+		std::string pending = documentPath;
+		for(size_t i = 0; ok && i < _records.size(); ++i)
+		{
+			record_t const& record = _records[i];
+
+			std::string body;
+			if(record.file_offset == -1)
+			{
+				body = serialize(record);
+			}
+			else // copy records never paged in verbatim
+			{
+				body.resize(record.file_length);
+				ok = pread(_history_fd, &body[0], body.size(), record.file_offset) == ssize_t(body.size());
+			}
+
+			entries.push_back({ uint64_t(offset), body.size(), record.pre_revision, record.post_revision });
+			offset += body.size();
+			pending += body;
+
+			if(pending.size() > 1024*1024 || i+1 == _records.size())
+			{
+				ok = ok && pwrite(fd, pending.data(), pending.size(), offset - pending.size()) == ssize_t(pending.size());
+				pending.clear();
+			}
+		}
+
+		header.index_offset = offset;
+		size_t const indexSize = entries.size() * sizeof(history_entry_t);
+		ok = ok && pwrite(fd, entries.data(), indexSize, offset) == ssize_t(indexSize);
+		ok = ok && pwrite(fd, &header, sizeof(header), 0) == ssize_t(sizeof(header));
+		ok = close(fd) == 0 && ok;
+
+		if(!ok || rename(tmp.c_str(), path.c_str()) != 0)
+		{
+			os_log_error(OS_LOG_DEFAULT, "Failed to write undo history ‘%{public}s’: %{errno}d", path.c_str(), errno);
+			unlink(tmp.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	bool undo_manager_t::load (std::string const& path, std::string const& documentPath)
+	{
+		if(!_records.empty())
+			return false;
+
+		int fd = open(path.c_str(), O_RDONLY|O_CLOEXEC);
+		if(fd == -1)
+			return false;
+
+		// Every size read from the file is checked against the file size before we allocate memory for it
+		struct stat buf;
+		history_header_t header;
+		bool ok = fstat(fd, &buf) == 0 && read(fd, &header, sizeof(header)) == ssize_t(sizeof(header));
+		uint64_t const fileSize = ok ? buf.st_size : 0;
+
+		ok = ok && std::equal(std::begin(kHistoryMagic), std::end(kHistoryMagic), header.magic) && header.version == kHistoryVersion;
+		ok = ok && header.index <= header.record_count && header.path_length == documentPath.size();
+		ok = ok && header.index_offset >= sizeof(header) + header.path_length && header.index_offset <= fileSize;
+		ok = ok && header.record_count <= (fileSize - header.index_offset) / sizeof(history_entry_t);
+		ok = ok && document_matches(header, documentPath, _buffer.size());
+
+		std::string storedPath(ok ? header.path_length : 0, '\0');
+		ok = ok && pread(fd, &storedPath[0], storedPath.size(), sizeof(header)) == ssize_t(storedPath.size()) && storedPath == documentPath;
+
+		std::vector<history_entry_t> entries(ok ? header.record_count : 0);
+		size_t const indexSize = entries.size() * sizeof(history_entry_t);
+		ok = ok && pread(fd, entries.data(), indexSize, header.index_offset) == ssize_t(indexSize);
+
+		for(size_t i = 0; ok && i < entries.size(); ++i)
+			ok = entries[i].offset >= sizeof(header) + header.path_length && entries[i].offset <= header.index_offset && entries[i].length <= header.index_offset - entries[i].offset;
+
+		if(!ok) // stale history: the document was changed by someone else
+		{
+			close(fd);
+			unlink(path.c_str());
+			return false;
+		}
+
+		// Revisions are only unique within a session so give each stored revision a new one
+		std::map<uint64_t, size_t> revisions = { { header.revision, _buffer.revision() } };
+		auto remap = [&](uint64_t rev) -> size_t {
+			auto it = revisions.find(rev);
+			if(it == revisions.end())
+				it = revisions.emplace(rev, _buffer.allocate_revision()).first;
+			return it->second;
+		};
+
+		_records.reserve(entries.size());
+		for(auto const& entry : entries)
+		{
+			_records.emplace_back(std::vector<change_t>(), ranges_t(), remap(entry.pre_revision));
+			_records.back().post_revision = remap(entry.post_revision);
+			_records.back().file_offset   = entry.offset;
+			_records.back().file_length   = entry.length;
+		}
+
+		_index = header.index;
+		_history_fd = fd;
+		_history_size = fileSize;
+		return true;
+	}
+
 } /* ng */
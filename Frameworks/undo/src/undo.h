@@ -3,6 +3,7 @@
 
 #include <buffer/src/buffer.h>
 #include <selection/src/selection.h>
+#include "arena.h"
 
 namespace ng
 {
@@ -21,40 +22,70 @@ namespace ng
 		ranges_t undo ();
 		ranges_t redo ();
 
+		// Bytes of undone/redone text kept in memory, older history is
+		// compressed to a temporary file once this is exceeded.
+		void set_memory_budget (size_t bytes) { _arena.set_budget(bytes); }
+		size_t memory_budget () const         { return _arena.budget(); }
+
+		// History is written for a buffer whose content matches the document
+		// on disk. It is tagged with the document’s path, size and modification
+		// date, and only restored if those and the buffer size still match.
+		// Loading reads just the index, records are paged in as undo reaches them.
+		bool save (std::string const& path, std::string const& documentPath);
+		bool load (std::string const& path, std::string const& documentPath);
+
 	private:
 		void will_replace (size_t from, size_t to, char const* buf, size_t len);
+		void will_replace_batch (std::vector<replacement_t> const& replacements);
 
 		struct buffer_callback_t : callback_t
 		{
 			buffer_callback_t (undo_manager_t& undo_manager) : undo_manager(undo_manager) { }
 
-			void will_replace (size_t from, size_t to, char const* buf, size_t len) { undo_manager.will_replace(from, to, buf, len); }
+			void will_replace (size_t from, size_t to, char const* buf, size_t len)     { undo_manager.will_replace(from, to, buf, len); }
+			void will_replace_batch (std::vector<replacement_t> const& replacements) { undo_manager.will_replace_batch(replacements); }
 		private:
 			undo_manager_t& undo_manager;
 		};
 
-		struct record_t
+		struct change_t
 		{
-			record_t (size_t pos, std::string const& before, std::string const& after, ranges_t const& selection, size_t revision) : pos(pos), before(before), after(after), pre_selection(selection), pre_revision(revision) { }
 			size_t pos;
-			std::string before;
-			std::string after;
+			detail::arena_t::ref_t before;
+			detail::arena_t::ref_t after;
+		};
+
+		struct record_t
+		{
+			record_t (std::vector<change_t> const& changes, ranges_t const& selection, size_t revision) : changes(changes), pre_selection(selection), pre_revision(revision) { }
+			std::vector<change_t> changes; // a bulk replace is one record with sorted changes in pre-edit coordinates
 			ranges_t pre_selection;
 			size_t pre_revision;
 			ranges_t post_selection;
 			size_t post_revision;
+			off_t file_offset = -1; // paged out when not -1
+			size_t file_length = 0;
 		};
 
 		bool should_merge (record_t const& r, record_t const& t);
+		bool coalesce (record_t& r, record_t const& t);
+		bool replacements_for (record_t const& r, bool undo, std::vector<replacement_t>& replacements);
+		void discard_records (size_t from, size_t to);
+		void add_record (std::vector<change_t> const& changes);
+		bool page_in (size_t index);
+		std::string serialize (record_t const& record);
 
 		buffer_t& _buffer;
 		buffer_callback_t _buffer_callback;
+		detail::arena_t _arena;
 		std::vector<record_t> _records;
 		size_t _index = 0;
 		size_t _nesting_count = 0;
 		ranges_t _pre_selection;
 		size_t _pre_revision;
 		size_t _changes;
+		int _history_fd = -1;
+		off_t _history_size = 0;
 	};
 
 } /* ng */
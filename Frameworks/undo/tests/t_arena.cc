@@ -0,0 +1,73 @@
+#include <undo/src/arena.h>
+
+static size_t const kChunkSize = 64*1024;
+
+static std::string chunk (size_t i)
+{
+	std::string res(kChunkSize, 'a' + i % 26);
+	res += std::to_string(i);
+	return res;
+}
+
+void test_arena_spill_and_page_in ()
+{
+	ng::detail::arena_t arena(512*1024);
+
+	std::vector<ng::detail::arena_t::ref_t> refs;
+	for(size_t i = 0; i < 64; ++i)
+		refs.push_back(arena.append(chunk(i)));
+
+	OAK_ASSERT_LE(arena.resident(), arena.budget());
+	OAK_ASSERT_GT(arena.spill_size(), 0);
+
+	for(size_t i = 0; i < refs.size(); ++i)
+	{
+		std::string str;
+		OAK_ASSERT(arena.read(refs[i], str));
+		OAK_ASSERT_EQ(str, chunk(i));
+		OAK_ASSERT_LE(arena.resident(), arena.budget());
+	}
+
+	arena.set_budget(SIZE_T_MAX);
+	for(size_t i = refs.size(); i-- > 0; )
+		OAK_ASSERT_EQ(arena.str(refs[i]), chunk(i));
+}
+
+void test_arena_join ()
+{
+	ng::detail::arena_t arena(SIZE_T_MAX);
+	ng::detail::arena_t::ref_t a = arena.append("foo");
+	ng::detail::arena_t::ref_t b = arena.append("bar");
+	ng::detail::arena_t::ref_t c = arena.append("baz");
+
+	OAK_ASSERT(!arena.join(a, c));
+	OAK_ASSERT(arena.join(a, b));
+	OAK_ASSERT(arena.join(a, c));
+	OAK_ASSERT_EQ(arena.str(a), "foobarbaz");
+}
+
+void test_arena_release ()
+{
+	ng::detail::arena_t arena(256*1024);
+
+	std::vector<ng::detail::arena_t::ref_t> refs;
+	for(size_t i = 0; i < 64; ++i)
+		refs.push_back(arena.append(chunk(i)));
+	off_t const spillSize = arena.spill_size();
+	OAK_ASSERT_GT(spillSize, 0);
+
+	// Dropping everything but the last chunk frees the spill file
+	for(size_t i = 0; i + 1 < refs.size(); ++i)
+		arena.release(refs[i]);
+	OAK_ASSERT_EQ(arena.spill_size(), 0);
+	OAK_ASSERT_LE(arena.resident(), kChunkSize + 32);
+	OAK_ASSERT_EQ(arena.str(refs.back()), chunk(refs.size()-1));
+
+	// Spilling the same amount again should not double the file
+	refs.clear();
+	for(size_t i = 0; i < 64; ++i)
+		refs.push_back(arena.append(chunk(i)));
+	OAK_ASSERT_LT(arena.spill_size(), spillSize + spillSize / 2);
+	for(size_t i = 0; i < refs.size(); ++i)
+		OAK_ASSERT_EQ(arena.str(refs[i]), chunk(i));
+}
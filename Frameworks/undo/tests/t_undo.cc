@@ -0,0 +1,240 @@
+#include <undo/src/undo.h>
+#include <io/src/path.h>
+#include <test/jail.h>
+
+static void type (ng::buffer_t& buf, ng::undo_manager_t& undoManager, std::string const& str)
+{
+	for(char ch : str)
+	{
+		size_t const caret = buf.size();
+		undoManager.begin_undo_group(ng::index_t(caret));
+		buf.insert(caret, std::string(1, ch));
+		undoManager.end_undo_group(ng::index_t(caret + 1));
+	}
+}
+
+static void backspace (ng::buffer_t& buf, ng::undo_manager_t& undoManager, size_t count)
+{
+	while(count--)
+	{
+		size_t const caret = buf.size();
+		undoManager.begin_undo_group(ng::index_t(caret));
+		buf.erase(caret - 1, caret);
+		undoManager.end_undo_group(ng::index_t(caret - 1));
+	}
+}
+
+void test_undo_backspace ()
+{
+	ng::buffer_t buf;
+	ng::undo_manager_t undoManager(buf);
+
+	type(buf, undoManager, "foo bar");
+	backspace(buf, undoManager, 3);
+	type(buf, undoManager, "baz");
+	OAK_ASSERT_EQ(buf.substr(0, buf.size()), "foo baz");
+
+	undoManager.undo(); // the last keystroke is undone on its own
+	OAK_ASSERT_EQ(buf.substr(0, buf.size()), "foo ba");
+	undoManager.undo();
+	OAK_ASSERT_EQ(buf.substr(0, buf.size()), "foo ");
+	undoManager.undo();
+	OAK_ASSERT_EQ(buf.substr(0, buf.size()), "foo bar");
+	undoManager.undo();
+	OAK_ASSERT_EQ(buf.substr(0, buf.size()), "foo ");
+
+	undoManager.redo();
+	OAK_ASSERT_EQ(buf.substr(0, buf.size()), "foo bar");
+	undoManager.redo();
+	OAK_ASSERT_EQ(buf.substr(0, buf.size()), "foo ");
+	undoManager.redo();
+	OAK_ASSERT_EQ(buf.substr(0, buf.size()), "foo baz");
+	OAK_ASSERT(!undoManager.can_redo());
+}
+
+void test_undo_after_spill ()
+{
+	ng::buffer_t buf;
+	ng::undo_manager_t undoManager(buf);
+	undoManager.set_memory_budget(0);
+
+	std::vector<std::string> versions(1, "");
+	for(size_t i = 0; i < 32; ++i)
+	{
+		versions.push_back(std::string(32*1024, 'a' + i % 26) + std::to_string(i));
+		undoManager.begin_undo_group(ng::index_t(0));
+		buf.replace(0, buf.size(), versions.back());
+		undoManager.end_undo_group(ng::index_t(buf.size()));
+	}
+
+	for(size_t i = versions.size() - 1; i-- > 0; )
+	{
+		OAK_ASSERT(undoManager.can_undo());
+		undoManager.undo();
+		OAK_ASSERT_EQ(buf.substr(0, buf.size()), versions[i]);
+	}
+	OAK_ASSERT(!undoManager.can_undo());
+
+	for(size_t i = 1; i < versions.size(); ++i)
+	{
+		undoManager.redo();
+		OAK_ASSERT_EQ(buf.substr(0, buf.size()), versions[i]);
+	}
+
+	// Discarding the redo history should reclaim its text
+	for(size_t i = 1; i < versions.size(); ++i)
+		undoManager.undo();
+	undoManager.begin_undo_group(ng::index_t(0));
+	buf.insert(0, "x");
+	undoManager.end_undo_group(ng::index_t(1));
+	OAK_ASSERT(!undoManager.can_redo());
+	undoManager.undo();
+	OAK_ASSERT_EQ(buf.substr(0, buf.size()), "");
+}
+
+// Undoes everything, returning the text after each step, then redoes it all again
+static std::vector<std::string> undo_and_redo_all (ng::buffer_t& buf, ng::undo_manager_t& undoManager)
+{
+	std::vector<std::string> res;
+	while(undoManager.can_undo())
+	{
+		undoManager.undo();
+		res.push_back(buf.substr(0, buf.size()));
+	}
+	while(undoManager.can_redo())
+	{
+		undoManager.redo();
+		res.push_back(buf.substr(0, buf.size()));
+	}
+	return res;
+}
+
+// Leaves the buffer with both undo and redo history
+static void make_history (ng::buffer_t& buf, ng::undo_manager_t& undoManager)
+{
+	type(buf, undoManager, "foo bar");
+	backspace(buf, undoManager, 3);
+	type(buf, undoManager, "baz qux");
+
+	undoManager.begin_undo_group(ng::index_t(0));
+	buf.replace({ { 0, 3, "FOO" }, { 4, 7, "BAZ" } });
+	undoManager.end_undo_group(ng::index_t(0));
+
+	undoManager.undo();
+	undoManager.undo();
+}
+
+static void rewind (ng::undo_manager_t& undoManager, size_t redoSteps)
+{
+	while(redoSteps--)
+		undoManager.undo();
+}
+
+void test_undo_history_round_trip ()
+{
+	test::jail_t jail;
+	std::string const documentPath = jail.path("document.txt");
+	std::string const historyPath  = jail.path("history");
+
+	ng::buffer_t buf;
+	ng::undo_manager_t undoManager(buf);
+	make_history(buf, undoManager);
+	std::string const text = buf.substr(0, buf.size());
+
+	size_t redoSteps = 0;
+	for(; undoManager.can_redo(); ++redoSteps)
+		undoManager.redo();
+	rewind(undoManager, redoSteps);
+	std::vector<std::string> const expected = undo_and_redo_all(buf, undoManager);
+	rewind(undoManager, redoSteps);
+
+	path::set_content(documentPath, text);
+	OAK_ASSERT(undoManager.save(historyPath, documentPath));
+
+	// Saving history that was loaded but not yet paged in copies the records verbatim
+	for(size_t i = 0; i < 2; ++i)
+	{
+		ng::buffer_t restoredBuf;
+		restoredBuf.insert(0, text);
+		ng::undo_manager_t restored(restoredBuf);
+		OAK_ASSERT(restored.load(historyPath, documentPath));
+		OAK_ASSERT(restored.save(historyPath, documentPath));
+	}
+
+	ng::buffer_t restoredBuf;
+	restoredBuf.insert(0, text);
+	ng::undo_manager_t restored(restoredBuf);
+	OAK_ASSERT(restored.load(historyPath, documentPath));
+	OAK_ASSERT(undo_and_redo_all(restoredBuf, restored) == expected);
+
+	// And once paged in the records are serialized again
+	rewind(restored, redoSteps);
+	OAK_ASSERT_EQ(restoredBuf.substr(0, restoredBuf.size()), text);
+	OAK_ASSERT(restored.save(historyPath, documentPath));
+
+	ng::buffer_t reloadedBuf;
+	reloadedBuf.insert(0, text);
+	ng::undo_manager_t reloaded(reloadedBuf);
+	OAK_ASSERT(reloaded.load(historyPath, documentPath));
+	OAK_ASSERT(undo_and_redo_all(reloadedBuf, reloaded) == expected);
+}
+
+void test_undo_history_stale ()
+{
+	test::jail_t jail;
+	std::string const documentPath = jail.path("document.txt");
+	std::string const historyPath  = jail.path("history");
+
+	ng::buffer_t buf;
+	ng::undo_manager_t undoManager(buf);
+	type(buf, undoManager, "foo");
+	path::set_content(documentPath, "foo");
+	OAK_ASSERT(undoManager.save(historyPath, documentPath));
+
+	ng::buffer_t otherBuf;
+	otherBuf.insert(0, "foo");
+	ng::undo_manager_t other(otherBuf);
+	OAK_ASSERT(!other.load(historyPath, jail.path("other.txt")));
+	OAK_ASSERT(!path::exists(historyPath));
+
+	OAK_ASSERT(undoManager.save(historyPath, documentPath));
+	path::set_content(documentPath, "foobar");
+	OAK_ASSERT(!other.load(historyPath, documentPath));
+	OAK_ASSERT(!path::exists(historyPath));
+}
+
+void test_undo_history_corrupt ()
+{
+	test::jail_t jail;
+	std::string const documentPath = jail.path("document.txt");
+	std::string const historyPath  = jail.path("history");
+
+	ng::buffer_t buf;
+	ng::undo_manager_t undoManager(buf);
+	type(buf, undoManager, "foo bar");
+	path::set_content(documentPath, "foo bar");
+	OAK_ASSERT(undoManager.save(historyPath, documentPath));
+	std::string const history = path::content(historyPath);
+
+	for(size_t len : { size_t(0), size_t(16), history.size() / 2, history.size() - 1 })
+	{
+		path::set_content(historyPath, history.substr(0, len));
+
+		ng::buffer_t restoredBuf;
+		restoredBuf.insert(0, "foo bar");
+		ng::undo_manager_t restored(restoredBuf);
+		OAK_ASSERT(!restored.load(historyPath, documentPath));
+	}
+
+	// Claim more records than the file could hold
+	std::string corrupt = history;
+	uint64_t const recordCount = UINT64_MAX / 2;
+	size_t const recordCountOffset = 4 + 4 + 5*8;
+	std::copy((char const*)&recordCount, (char const*)&recordCount + sizeof(recordCount), corrupt.begin() + recordCountOffset);
+	path::set_content(historyPath, corrupt);
+
+	ng::buffer_t restoredBuf;
+	restoredBuf.insert(0, "foo bar");
+	ng::undo_manager_t restored(restoredBuf);
+	OAK_ASSERT(!restored.load(historyPath, documentPath));
+}
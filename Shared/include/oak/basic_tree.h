@@ -222,6 +222,23 @@ namespace oak
 			}
 		}
 
+		// Nodes are relinked rather than moved when the tree changes, so an iterator stays valid until its element is erased, but its offset is stale. This returns it with the current offset in O(log n).
+		iterator refresh (iterator const& it)
+		{
+			iterator res(it._node, this);
+			if(!it._node->is_null())
+			{
+				_KeyT offset = it._node->_left->key_offset();
+				for(node_t* node = it._node; !node->_parent->is_null(); node = node->_parent)
+				{
+					if(eq(node->_parent->_right, node))
+						offset = node->_parent->_left->key_offset() + node->_parent->relative_key() + offset;
+				}
+				res._info.offset = offset;
+			}
+			return res;
+		}
+
 		void update_key (iterator it)
 		{
 			for(node_t* node = it._node; !node->is_null(); node = node->_parent)
@@ -1,6 +1,8 @@
 #ifndef OAK_DURATION_H_NQISZ9T7
 #define OAK_DURATION_H_NQISZ9T7
 
+#include <chrono>
+
 namespace oak
 {
 	struct duration_t
@@ -12,21 +14,16 @@ namespace oak
 
 		void reset ()
 		{
-			struct timeval now;
-			gettimeofday(&now, NULL);
-			start_time = (double)now.tv_sec + (double)now.tv_usec / 1000000.0;
+			start_time = std::chrono::steady_clock::now();
 		}
 
 		double duration () const
 		{
-			struct timeval now;
-			gettimeofday(&now, NULL);
-			double elapsed = (double)now.tv_sec + (double)now.tv_usec / 1000000.0;
-			return elapsed - start_time;
+			return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
 		}
 
 	private:
-		double start_time;
+		std::chrono::steady_clock::time_point start_time;
 	};
 
 } /* oak */
@@ -0,0 +1,237 @@
+#ifndef OAK_TRACE_H_5RJ2WQ8L
+#define OAK_TRACE_H_5RJ2WQ8L
+
+#include <atomic>
+#include <chrono>
+
+// Usage: oak::trace::span_t span("parse", "line");
+//
+// A span records when it was created and destroyed, so declare it at the
+// top of the scope being measured. Category and name must be string
+// literals (only the pointers are stored), an optional detail string is
+// copied. When tracing is disabled the cost is a relaxed load of a global
+// flag.
+//
+// Each thread writes to its own ring buffer holding the most recent
+// kCapacity spans. write_chrome_json() exports all buffers in the Chrome
+// trace event format, which can be opened with chrome://tracing or
+// https://ui.perfetto.dev.
+
+namespace oak
+{
+	namespace trace
+	{
+		namespace detail
+		{
+			inline uint64_t now ()
+			{
+				return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+			}
+
+			struct event_t
+			{
+				char const* category;
+				char const* name;
+				std::string detail;
+				uint64_t start, duration; // nanoseconds
+			};
+
+			struct thread_buffer_t
+			{
+				static size_t const kCapacity = 8192;
+
+				thread_buffer_t ()
+				{
+					pthread_threadid_np(nullptr, &thread_id);
+					char buf[64];
+					if(pthread_getname_np(pthread_self(), buf, sizeof(buf)) == 0)
+						thread_name = buf;
+				}
+
+				void append (char const* category, char const* name, std::string const& detail, uint64_t start, uint64_t end)
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					if(events.size() < kCapacity)
+						events.emplace_back();
+					event_t& event = events[next++ % kCapacity];
+					event.category = category;
+					event.name     = name;
+					event.start    = start;
+					event.duration = end - start;
+					event.detail   = detail;
+				}
+
+				uint64_t thread_id = 0;
+				std::string thread_name;
+				std::mutex mutex;
+				std::vector<event_t> events;
+				size_t next = 0;
+			};
+
+			inline std::atomic<bool> enabled(false);
+
+			inline std::mutex& registry_mutex ()
+			{
+				static std::mutex* res = new std::mutex;
+				return *res;
+			}
+
+			// Buffers are kept after their thread exits so that short-lived
+			// worker threads still show up in the export.
+			inline std::vector<std::shared_ptr<thread_buffer_t>>& registry ()
+			{
+				static auto* res = new std::vector<std::shared_ptr<thread_buffer_t>>;
+				return *res;
+			}
+
+			inline thread_buffer_t& current_buffer ()
+			{
+				static thread_local std::shared_ptr<thread_buffer_t> buffer;
+				if(!buffer)
+				{
+					buffer = std::make_shared<thread_buffer_t>();
+					std::lock_guard<std::mutex> lock(registry_mutex());
+					registry().push_back(buffer);
+				}
+				return *buffer;
+			}
+
+			inline std::string json_escape (std::string const& str)
+			{
+				std::string res;
+				for(char ch : str)
+				{
+					if(ch == '"' || ch == '\\')
+					{
+						res += '\\';
+						res += ch;
+					}
+					else if((unsigned char)ch < 0x20)
+					{
+						char buf[8];
+						snprintf(buf, sizeof(buf), "\\u%04x", ch);
+						res += buf;
+					}
+					else
+					{
+						res += ch;
+					}
+				}
+				return res;
+			}
+
+		} /* detail */
+
+		inline bool enabled ()
+		{
+			return detail::enabled.load(std::memory_order_relaxed);
+		}
+
+		inline void set_enabled (bool flag)
+		{
+			detail::enabled.store(flag, std::memory_order_relaxed);
+		}
+
+		inline void clear ()
+		{
+			std::lock_guard<std::mutex> lock(detail::registry_mutex());
+			for(auto const& buffer : detail::registry())
+			{
+				std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+				buffer->events.clear();
+				buffer->next = 0;
+			}
+		}
+
+		struct span_t
+		{
+			span_t (char const* category, char const* name) : _category(category), _name(name)
+			{
+				if(enabled())
+					_start = detail::now();
+			}
+
+			span_t (char const* category, char const* name, std::string const& info) : _category(category), _name(name)
+			{
+				if(enabled())
+				{
+					_info  = info;
+					_start = detail::now();
+				}
+			}
+
+			~span_t ()
+			{
+				if(_start && enabled())
+					detail::current_buffer().append(_category, _name, _info, _start, detail::now());
+			}
+
+			span_t (span_t const& rhs) = delete;
+			span_t& operator= (span_t const& rhs) = delete;
+
+		private:
+			char const* _category;
+			char const* _name;
+			std::string _info; // e.g. the path being read
+			uint64_t _start = 0;
+		};
+
+		inline bool write_chrome_json (std::string const& path)
+		{
+			FILE* fp = fopen(path.c_str(), "w");
+			if(!fp)
+			{
+				os_log_error(OS_LOG_DEFAULT, "Unable to write trace to ‘%{public}s’: %{errno}d", path.c_str(), errno);
+				return false;
+			}
+
+			std::lock_guard<std::mutex> lock(detail::registry_mutex());
+
+			uint64_t origin = UINT64_MAX;
+			for(auto const& buffer : detail::registry())
+			{
+				std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+				for(auto const& event : buffer->events)
+					origin = std::min(origin, event.start);
+			}
+
+			int const pid = getpid();
+			char const* separator = "";
+
+			fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+			for(auto const& buffer : detail::registry())
+			{
+				std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+				if(buffer->events.empty())
+					continue;
+
+				if(!buffer->thread_name.empty())
+				{
+					fprintf(fp, "%s\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%llu,\"args\":{\"name\":\"%s\"}}", separator, pid, buffer->thread_id, detail::json_escape(buffer->thread_name).c_str());
+					separator = ",";
+				}
+
+				size_t const count = buffer->events.size();
+				for(size_t i = 0; i < count; ++i)
+				{
+					auto const& event = buffer->events[(buffer->next + i) % count]; // oldest first
+					fprintf(fp, "%s\n{\"ph\":\"X\",\"cat\":\"%s\",\"name\":\"%s\",\"pid\":%d,\"tid\":%llu,\"ts\":%.3f,\"dur\":%.3f", separator, event.category, event.name, pid, buffer->thread_id, (event.start - origin) / 1000.0, event.duration / 1000.0);
+					if(!event.detail.empty())
+						fprintf(fp, ",\"args\":{\"detail\":\"%s\"}", detail::json_escape(event.detail).c_str());
+					fprintf(fp, "}");
+					separator = ",";
+				}
+			}
+			fprintf(fp, "\n]}\n");
+
+			bool res = ferror(fp) == 0;
+			if(fclose(fp) != 0)
+				res = false;
+			return res;
+		}
+
+	} /* trace */
+
+} /* oak */
+
+#endif /* end of include guard: OAK_TRACE_H_5RJ2WQ8L */
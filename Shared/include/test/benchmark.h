@@ -0,0 +1,47 @@
+#ifndef TEST_BENCHMARK_H_8QK2XN4V
+#define TEST_BENCHMARK_H_8QK2XN4V
+
+#include <chrono>
+
+namespace test
+{
+	// Runs ‘body’ until at least ‘minDuration’ seconds have passed and reports
+	// the mean time per iteration. Results are appended as one JSON object per
+	// line to the file named by BENCHMARK_RESULTS (or written to stderr) so
+	// that runs can be compared across builds.
+
+	template <typename F>
+	double benchmark (char const* name, F body, size_t bytesPerIteration = 0, double minDuration = 0.5)
+	{
+		typedef std::chrono::steady_clock clock_t;
+
+		body(); // warm up caches and lazily initialized state
+
+		size_t iterations = 0;
+		clock_t::time_point const start = clock_t::now();
+		std::chrono::duration<double> elapsed;
+		do {
+			body();
+			++iterations;
+			elapsed = clock_t::now() - start;
+		} while(elapsed.count() < minDuration);
+
+		double const nsPerIteration = 1e9 * elapsed.count() / iterations;
+		double const mbPerSecond    = bytesPerIteration ? bytesPerIteration * iterations / elapsed.count() / (1024*1024) : 0;
+
+		char const* path = getenv("BENCHMARK_RESULTS");
+		if(FILE* fp = path ? fopen(path, "a") : stderr)
+		{
+			fprintf(fp, "{\"name\":\"%s\",\"iterations\":%zu,\"ns_per_iteration\":%.1f", name, iterations, nsPerIteration);
+			if(bytesPerIteration)
+				fprintf(fp, ",\"bytes_per_iteration\":%zu,\"mb_per_second\":%.2f", bytesPerIteration, mbPerSecond);
+			fprintf(fp, "}\n");
+			if(fp != stderr)
+				fclose(fp);
+		}
+		return nsPerIteration;
+	}
+
+} /* test */
+
+#endif /* end of include guard: TEST_BENCHMARK_H_8QK2XN4V */